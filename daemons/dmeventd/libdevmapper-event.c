@@ -32,6 +32,17 @@
 
 static int _sequence_nr = 0;
 
+/*
+ * Connection kept open between dm_event_hold_connection() and the
+ * matching dm_event_release_connection() so a series of requests
+ * pays for daemon startup check and HELLO only once.
+ * The server fifo is locked only around each request, so other
+ * clients are not shut out of dmeventd while the connection is held.
+ */
+static struct dm_event_fifos _held_fifos;
+static int _held_fifos_open = 0;
+static unsigned _hold_count = 0;
+
 struct dm_event_handler {
 	char *dso;
 
@@ -583,6 +594,15 @@ static struct dm_task *_get_device_info(const struct dm_event_handler *dmevh)
 	return NULL;
 }
 
+static void _close_held_connection(void)
+{
+	if (!_held_fifos_open)
+		return;
+
+	fini_fifos(&_held_fifos);
+	_held_fifos_open = 0;
+}
+
 /* Handle the event (de)registration call and return negative error codes. */
 static int _do_event(int cmd, char *dmeventd_path, struct dm_event_daemon_message *msg,
 		     const char *dso_name, const char *dev_name,
@@ -591,6 +611,26 @@ static int _do_event(int cmd, char *dmeventd_path, struct dm_event_daemon_messag
 	int ret;
 	struct dm_event_fifos fifos;
 
+	if (_held_fifos_open) {
+		if (flock(_held_fifos.server, LOCK_EX) < 0) {
+			log_sys_error("flock", _held_fifos.server_path);
+			_close_held_connection();
+			return -EIO;
+		}
+
+		ret = daemon_talk(&_held_fifos, msg, cmd, dso_name, dev_name, evmask, timeout);
+
+		/* Daemon went away under us - drop the connection for next request. */
+		if (ret == -EIO)
+			_close_held_connection();
+		else if (flock(_held_fifos.server, LOCK_UN)) {
+			log_sys_error("flock unlock", _held_fifos.server_path);
+			_close_held_connection();
+		}
+
+		return ret;
+	}
+
 	if (!_init_client(dmeventd_path, &fifos)) {
 		stack;
 		return -ESRCH;
@@ -604,12 +644,35 @@ static int _do_event(int cmd, char *dmeventd_path, struct dm_event_daemon_messag
 	if (!ret)
 		ret = daemon_talk(&fifos, msg, cmd, dso_name, dev_name, evmask, timeout);
 
+	/* Keep the fifos open, but let other clients in between requests. */
+	if (_hold_count && ret != -EIO && !flock(fifos.server, LOCK_UN)) {
+		_held_fifos = fifos;
+		_held_fifos_open = 1;
+		return ret;
+	}
+
 	/* what is the opposite of init? */
 	fini_fifos(&fifos);
 
 	return ret;
 }
 
+void dm_event_hold_connection(void)
+{
+	_hold_count++;
+}
+
+void dm_event_release_connection(void)
+{
+	if (!_hold_count) {
+		log_error(INTERNAL_ERROR "dmeventd connection released more than held.");
+		return;
+	}
+
+	if (!--_hold_count)
+		_close_held_connection();
+}
+
 /* External library interface. */
 int dm_event_register_handler(const struct dm_event_handler *dmevh)
 {
@@ -104,6 +104,17 @@ int dm_event_get_registered_device(struct dm_event_handler *dmevh, int next);
 int dm_event_register_handler(const struct dm_event_handler *dmevh);
 int dm_event_unregister_handler(const struct dm_event_handler *dmevh);
 
+/*
+ * Keep the connection to dmeventd open across the requests issued
+ * until the matching release, so a series of (un)registrations does
+ * not reconnect and repeat the handshake for every device.
+ * The daemon is locked only for the duration of each request, so
+ * other clients may talk to dmeventd while a connection is held.
+ * Calls nest; the connection is closed by the outermost release.
+ */
+void dm_event_hold_connection(void);
+void dm_event_release_connection(void);
+
 /* Prototypes for DSO interface, see dmeventd.c, struct dso_data for
    detailed descriptions. */
 // FIXME  misuse of bitmask as enum
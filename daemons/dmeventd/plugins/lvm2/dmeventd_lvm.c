@@ -22,6 +22,7 @@
 
 #include <pthread.h>
 #include <syslog.h>
+#include <sys/time.h>
 
 extern int dmeventd_debug;
 
@@ -43,6 +44,31 @@ static void *_lvm_handle = NULL;
  */
 static pthread_mutex_t _event_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+/*
+ * Serialises use of the liblvm2cmd handle.  Repairs run it with the
+ * event lock released so that failures reported meanwhile can queue up.
+ * Never wait for the event lock while holding this one.
+ */
+static pthread_mutex_t _lvm_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Failed LVs waiting for repair.  The first failure in a VG is repaired
+ * straight away; those reported while a repair of the VG is running are
+ * repaired together by one command afterwards.  Protected by _event_mutex.
+ */
+struct repair_request {
+	struct dm_list list;
+	char *lv_name;		/* vg/lv */
+	size_t vg_len;
+	struct timeval detected;
+	int taken;		/* Part of the batch being repaired */
+	int done;
+	int result;
+};
+
+static DM_LIST_INIT(_repair_queue);
+static pthread_cond_t _repair_cond = PTHREAD_COND_INITIALIZER;
+
 /*
  * FIXME Do not pass things directly to syslog, rather use the existing logging
  * facilities to sort logging ... however that mechanism needs to be somehow
@@ -143,28 +169,53 @@ struct dm_pool *dmeventd_lvm2_pool(void)
 	return _mem_pool;
 }
 
+static int _lvm2_run(const char *cmdline)
+{
+	int r;
+
+	pthread_mutex_lock(&_lvm_mutex);
+	r = lvm2_run(_lvm_handle, cmdline);
+	pthread_mutex_unlock(&_lvm_mutex);
+
+	return r;
+}
+
 int dmeventd_lvm2_run(const char *cmdline)
 {
-	return lvm2_run(_lvm_handle, cmdline);
+	return _lvm2_run(cmdline);
 }
 
-int dmeventd_lvm2_command(struct dm_pool *mem, char *buffer, size_t size,
-			  const char *cmd, const char *device)
+/*
+ * Split a device name into VG and LV, without mirror log suffix.
+ * Free *vg from mem when done.
+ */
+static int _split_device_name(struct dm_pool *mem, const char *device,
+			      char **vg, char **lv)
 {
-	char *vg = NULL, *lv = NULL, *layer;
-	int r;
+	char *layer;
 
-	if (!dm_split_lvm_name(mem, device, &vg, &lv, &layer)) {
+	if (!dm_split_lvm_name(mem, device, vg, lv, &layer)) {
 		syslog(LOG_ERR, "Unable to determine VG name from %s.\n",
 		       device);
 		return 0;
 	}
 
 	/* strip off the mirror component designations */
-	layer = strstr(lv, "_mlog");
-	if (layer)
+	if ((layer = strstr(*lv, "_mlog")))
 		*layer = '\0';
 
+	return 1;
+}
+
+int dmeventd_lvm2_command(struct dm_pool *mem, char *buffer, size_t size,
+			  const char *cmd, const char *device)
+{
+	char *vg = NULL, *lv = NULL;
+	int r;
+
+	if (!_split_device_name(mem, device, &vg, &lv))
+		return 0;
+
 	r = dm_snprintf(buffer, size, "%s %s/%s", cmd, vg, lv);
 
 	dm_pool_free(mem, vg);
@@ -176,3 +227,180 @@ int dmeventd_lvm2_command(struct dm_pool *mem, char *buffer, size_t size,
 
 	return 1;
 }
+
+static int _same_vg(const struct repair_request *a, const struct repair_request *b)
+{
+	return a->vg_len == b->vg_len && !strncmp(a->lv_name, b->lv_name, a->vg_len);
+}
+
+static long _ms_since(const struct timeval *tv)
+{
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+
+	return (now.tv_sec - tv->tv_sec) * 1000 +
+		(now.tv_usec - tv->tv_usec) / 1000;
+}
+
+/*
+ * Build "lvconvert --repair --use-policies vg/lv1 vg/lv2..." for the
+ * taken requests of req's VG, each LV once.  Returns the LV count.
+ */
+static unsigned _repair_command(const struct repair_request *req, char **cmd_str)
+{
+	static const char _cmd[] = "lvconvert --repair --use-policies";
+	struct repair_request *r, *dup;
+	size_t len = sizeof(_cmd);
+	unsigned count = 0;
+	char *pos;
+
+	dm_list_iterate_items(r, &_repair_queue)
+		if (r->taken && _same_vg(r, req))
+			len += strlen(r->lv_name) + 1;
+
+	if (!(*cmd_str = pos = dm_malloc(len))) {
+		syslog(LOG_ERR, "Unable to allocate LVM command.\n");
+		return 0;
+	}
+
+	pos += sprintf(pos, "%s", _cmd);
+
+	dm_list_iterate_items(r, &_repair_queue) {
+		if (!r->taken || !_same_vg(r, req))
+			continue;
+
+		/* Several devices of the same LV may report the failure. */
+		dm_list_iterate_items(dup, &_repair_queue) {
+			if (dup == r || (dup->taken && !strcmp(dup->lv_name, r->lv_name)))
+				break;
+		}
+		if (dup != r)
+			continue;
+
+		pos += sprintf(pos, " %s", r->lv_name);
+		count++;
+	}
+
+	return count;
+}
+
+/*
+ * Repair the taken requests of req's VG with the event lock released.
+ * If a batch of several LVs fails, each LV is retried on its own so the
+ * result reported for it is its own.
+ */
+static void _run_repairs(const struct repair_request *req)
+{
+	struct repair_request *r, *t;
+	char *cmd_str = NULL, *single;
+	unsigned count;
+	int result;
+
+	if (!(count = _repair_command(req, &cmd_str)))
+		result = 0;
+	else {
+		pthread_mutex_unlock(&_event_mutex);
+
+		pthread_mutex_lock(&_lvm_mutex);
+		/*
+		 * Forget devices seen before the failure, so the repair
+		 * looks at the devices as they are now.
+		 */
+		if (lvm2_run(_lvm_handle, "_lvmcache_wipe") != ECMD_PROCESSED)
+			syslog(LOG_ERR, "Failed to wipe cached device state.");
+		result = (lvm2_run(_lvm_handle, cmd_str) == ECMD_PROCESSED);
+		pthread_mutex_unlock(&_lvm_mutex);
+
+		pthread_mutex_lock(&_event_mutex);
+	}
+
+	dm_list_iterate_items(r, &_repair_queue) {
+		if (!r->taken || !_same_vg(r, req))
+			continue;
+
+		r->result = result;
+		if (!result && count > 1 &&
+		    dm_asprintf(&single, "lvconvert --repair --use-policies %s",
+				r->lv_name) >= 0) {
+			r->result = (_lvm2_run(single) == ECMD_PROCESSED);
+			dm_free(single);
+		}
+
+		if (r->result)
+			syslog(LOG_INFO, "%s is redundant again %ld ms after its "
+			       "failure was detected.", r->lv_name,
+			       _ms_since(&r->detected));
+		else
+			syslog(LOG_ERR, "Repair of %s failed.", r->lv_name);
+	}
+
+	if (count > 1)
+		syslog(LOG_INFO, "Repaired %u LVs in VG %.*s with one command.",
+		       count, (int) req->vg_len, req->lv_name);
+
+	dm_free(cmd_str);
+
+	dm_list_iterate_items_safe(r, t, &_repair_queue)
+		if (r->taken && _same_vg(r, req)) {
+			r->done = 1;
+			dm_list_del(&r->list);
+		}
+
+	pthread_cond_broadcast(&_repair_cond);
+}
+
+/*
+ * Called with the event lock held.  If no repair of the VG is under
+ * way, the caller repairs its LV at once and then keeps repairing the
+ * LVs of the VG that failed in the meantime, all of them together.
+ * Otherwise it waits for the running repair to take care of its LV.
+ */
+int dmeventd_lvm2_repair(const char *device)
+{
+	struct repair_request req = { .done = 0 }, *r;
+	char *vg = NULL, *lv = NULL;
+	int leader = 1, pending;
+
+	if (!_split_device_name(_mem_pool, device, &vg, &lv))
+		return 0;
+
+	req.vg_len = strlen(vg);
+	if (dm_asprintf(&req.lv_name, "%s/%s", vg, lv) < 0)
+		req.lv_name = NULL;
+
+	dm_pool_free(_mem_pool, vg);
+
+	if (!req.lv_name) {
+		syslog(LOG_ERR, "Unable to allocate repair request for %s.\n",
+		       device);
+		return 0;
+	}
+
+	gettimeofday(&req.detected, NULL);
+
+	dm_list_iterate_items(r, &_repair_queue)
+		if (_same_vg(r, &req))
+			leader = 0;
+
+	dm_list_add(&_repair_queue, &req.list);
+
+	if (leader)
+		do {
+			pending = 0;
+			dm_list_iterate_items(r, &_repair_queue)
+				if (_same_vg(r, &req)) {
+					r->taken = 1;
+					pending = 1;
+				}
+			if (pending)
+				_run_repairs(&req);
+		} while (pending);
+	else
+		while (!req.done)
+			pthread_cond_wait(&_repair_cond, &_event_mutex);
+
+	dm_free(req.lv_name);
+
+	return req.result;
+}
@@ -39,4 +39,10 @@ struct dm_pool *dmeventd_lvm2_pool(void);
 int dmeventd_lvm2_command(struct dm_pool *mem, char *buffer, size_t size,
 			  const char *cmd, const char *device);
 
+/*
+ * Repair the LV behind device together with other failed LVs in its VG.
+ * Must be called with the event lock held.  Returns 1 on success.
+ */
+int dmeventd_lvm2_repair(const char *device);
+
 #endif /* _DMEVENTD_LVMWRAP_H */
@@ -24,27 +24,14 @@
 /* FIXME Replace most syslogs with log_error() style messages and add complete context. */
 /* FIXME Reformat to 80 char lines. */
 
-/*
- * run_repair is a close copy to
- * plugins/mirror/dmeventd_mirror.c:_remove_failed_devices()
- */
 static int run_repair(const char *device)
 {
-	int r;
-#define CMD_SIZE 256	/* FIXME Use system restriction */
-	char cmd_str[CMD_SIZE];
-
-	if (!dmeventd_lvm2_command(dmeventd_lvm2_pool(), cmd_str, sizeof(cmd_str),
-				  "lvconvert --config devices{ignore_suspended_devices=1} "
-				  "--repair --use-policies", device))
-		return -1;
-
-	r = dmeventd_lvm2_run(cmd_str);
-
-	if (r != ECMD_PROCESSED)
+	if (!dmeventd_lvm2_repair(device)) {
 		syslog(LOG_INFO, "Repair of RAID device %s failed.", device);
+		return -1;
+	}
 
-	return (r == ECMD_PROCESSED) ? 0 : -1;
+	return 0;
 }
 
 static int _process_raid_event(char *params, const char *device)
@@ -22,6 +22,7 @@
 #include "lvm-string.h"
 
 #include <sys/wait.h>
+#include <time.h>
 #include <syslog.h> /* FIXME Replace syslog with multilog */
 /* FIXME Missing openlog? */
 
@@ -31,6 +32,10 @@
 #define CHECK_STEP 5
 /* Do not bother checking snapshots less than 50% full. */
 #define CHECK_MINIMUM 50
+/* Run a check every time when overflow is expected within 2 intervals. */
+#define PREDICT_INTERVALS 2
+/* Fixed point shift used for the fill rate. */
+#define RATE_SHIFT 8
 
 #define UMOUNT_COMMAND "/bin/umount"
 
@@ -43,6 +48,10 @@ struct snap_status {
 struct dso_state {
 	int percent_check;
 	int known_size;
+	int last_used;		/* Sectors used at the previous event */
+	time_t last_time;	/* When the previous event was seen */
+	time_t interval;	/* Seconds between the last two timeouts */
+	uint64_t fill_rate;	/* Smoothed sectors per second << RATE_SHIFT */
 	char cmd_str[1024];
 };
 
@@ -80,6 +89,42 @@ static void _parse_snapshot_params(char *params, struct snap_status *status)
 	status->max = atoi(p);
 }
 
+/*
+ * Update the fill rate history of the snapshot and return the number
+ * of seconds until it is predicted to overflow, or 0 if not growing.
+ */
+static uint64_t _predict_overflow(struct dso_state *state,
+				  const struct snap_status *status,
+				  enum dm_event_mask event)
+{
+	time_t now = time(NULL);
+	uint64_t sample;
+
+	if (state->last_time && now > state->last_time) {
+		if (status->used < state->last_used)
+			state->fill_rate = 0; /* Merged or recreated. */
+		else {
+			sample = ((uint64_t) (status->used - state->last_used)
+				  << RATE_SHIFT) / (uint64_t) (now - state->last_time);
+			/* Newest sample weighs a quarter. */
+			state->fill_rate = state->fill_rate ?
+				(3 * state->fill_rate + sample) / 4 : sample;
+		}
+
+		if (event & DM_EVENT_TIMEOUT)
+			state->interval = now - state->last_time;
+	}
+
+	state->last_used = status->used;
+	state->last_time = now;
+
+	if (!state->fill_rate)
+		return 0;
+
+	return (((uint64_t) (status->max - status->used) << RATE_SHIFT) /
+		state->fill_rate) + 1;
+}
+
 static int _run(const char *cmd, ...)
 {
         va_list ap;
@@ -166,7 +211,7 @@ static void _umount(const char *device, int major, int minor)
 }
 
 void process_event(struct dm_task *dmt,
-		   enum dm_event_mask event __attribute__((unused)),
+		   enum dm_event_mask event,
 		   void **private)
 {
 	void *next = NULL;
@@ -175,7 +220,8 @@ void process_event(struct dm_task *dmt,
 	char *params;
 	struct snap_status status = { 0 };
 	const char *device = dm_task_get_name(dmt);
-	int percent;
+	int percent, imminent;
+	uint64_t overflow_secs;
 	struct dso_state *state = *private;
 
 	/* No longer monitoring, waiting for remove */
@@ -216,13 +262,28 @@ void process_event(struct dm_task *dmt,
 	}
 
 	percent = 100 * status.used / status.max;
-	if (percent >= state->percent_check) {
+
+	/*
+	 * Snapshots filling up fast could overflow between two steps.
+	 * Run the actions on every timeout once the fill rate predicts
+	 * an overflow before the next few timeouts, so the extension
+	 * is issued ahead of it rather than after the next step.
+	 */
+	overflow_secs = _predict_overflow(state, &status, event);
+	imminent = overflow_secs && state->interval &&
+		overflow_secs <= (uint64_t) PREDICT_INTERVALS * state->interval;
+
+	if (percent >= state->percent_check || imminent) {
 		/* Usage has raised more than CHECK_STEP since the last
-		   time. Run actions. */
-		state->percent_check = (percent / CHECK_STEP) * CHECK_STEP + CHECK_STEP;
+		   time or it is about to overflow. Run actions. */
+		if (percent >= state->percent_check)
+			state->percent_check = (percent / CHECK_STEP) * CHECK_STEP + CHECK_STEP;
 
 		if (percent >= WARNING_THRESH) /* Print a warning to syslog. */
 			syslog(LOG_WARNING, "Snapshot %s is now %i%% full.\n", device, percent);
+		if (imminent)
+			syslog(LOG_WARNING, "Snapshot %s is predicted to overflow "
+			       "in %" PRIu64 " seconds.\n", device, overflow_secs);
 		/* Try to extend the snapshot, in accord with user-set policies */
 		if (!_extend(state->cmd_str))
 			syslog(LOG_ERR, "Failed to extend snapshot %s.\n", device);
@@ -58,6 +58,19 @@ daemon_reply lvmetad_remove_pv(daemon_handle h, const char *pv_uuid);
  */
 daemon_reply lvmetad_supersede_vg(daemon_handle h, struct volume_group *vg);
 
+/*
+ * Subscribe to change notifications on a connection of its own. After an "OK"
+ * reply, daemon_read_reply blocks until the next notification: a message whose
+ * "notification" is vg_update (with vgid, name, seqno), vg_remove (vgid),
+ * pv_found (pvid, device, vgid), pv_gone (pvid, device) or overflow, meaning
+ * some notifications were lost and everything needs refetching. No further
+ * requests may be sent; lvmetad_close ends the subscription.
+ */
+static inline daemon_reply lvmetad_subscribe(daemon_handle h)
+{
+	return daemon_send_simple(h, "subscribe", NULL);
+}
+
 /* Wrappers to open/close connection */
 
 static inline daemon_handle lvmetad_open(const char *socket)
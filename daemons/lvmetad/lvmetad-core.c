@@ -23,23 +23,65 @@
 #include <malloc.h>
 #include <stdint.h>
 #include <unistd.h>
+#include <poll.h>
+#include <errno.h>
 
 typedef struct {
 	struct dm_hash_table *pvid_to_pvmeta;
 	struct dm_hash_table *device_to_pvid; /* shares locks with above */
 
-	struct dm_hash_table *vgid_to_metadata;
+	struct dm_hash_table *vgid_to_metadata; /* vg_metadata */
 	struct dm_hash_table *vgid_to_vgname;
 	struct dm_hash_table *vgname_to_vgid;
 	struct dm_hash_table *pvid_to_vgid;
+	uint64_t generation; /* last one given out, under lock.vgid_to_metadata */
+	struct dm_list subscribers;
 	struct {
 		struct dm_hash_table *vg;
 		pthread_mutex_t pvid_to_pvmeta;
 		pthread_mutex_t vgid_to_metadata;
 		pthread_mutex_t pvid_to_vgid;
+		pthread_mutex_t subscribers; /* never held while taking another */
 	} lock;
 } lvmetad_state;
 
+/*
+ * A client that asked to be told about changes. Notifications are queued by
+ * whichever thread makes the change and written out by the subscriber's own
+ * connection thread, which the wake pipe rouses. A subscriber that does not
+ * keep up loses notifications beyond SUBSCRIBER_QUEUE_MAX and is told so.
+ */
+#define SUBSCRIBER_QUEUE_MAX (1024 * 1024)
+
+typedef struct {
+	struct dm_list list;
+	int wake[2];
+	int woken;
+	int overflow;
+	char *queue;
+	size_t queue_used;
+	size_t queue_size;
+} subscriber;
+
+/*
+ * VG metadata is kept as its canonical text rather than as a config tree:
+ * a tree costs a node, a value and a key copy for every setting, which for
+ * large VGs is several times the size of the text.  The few things needed
+ * without a tree (seqno, names and the list of PVs) are kept alongside.  A
+ * tree is only parsed from the text when a client asks for the VG.
+ */
+typedef struct {
+	struct dm_pool *mem;
+	const char *vgid;
+	const char *name;
+	int seqno;
+	uint64_t generation; /* changes whenever vg_lookup would answer differently */
+	unsigned pv_count;
+	const char **pvids;
+	const char *text; /* "metadata { ... }" */
+	size_t text_size;
+} vg_metadata;
+
 __attribute__ ((format(printf, 1, 2)))
 static void debug(const char *fmt, ...) {
 	va_list ap;
@@ -50,16 +92,6 @@ static void debug(const char *fmt, ...) {
 	fflush(stderr);
 }
 
-static int debug_cft_line(const char *line, void *baton) {
-	fprintf(stderr, "| %s\n", line);
-	return 0;
-}
-
-static void debug_cft(const char *id, struct dm_config_node *n) {
-	debug("%s\n", id);
-	dm_config_write_node(n, &debug_cft_line, NULL);
-}
-
 static void lock_pvid_to_pvmeta(lvmetad_state *s) {
 	pthread_mutex_lock(&s->lock.pvid_to_pvmeta); }
 static void unlock_pvid_to_pvmeta(lvmetad_state *s) {
@@ -80,9 +112,9 @@ static void unlock_pvid_to_vgid(lvmetad_state *s) {
  * since if we have many "rogue" requests for nonexistent things, we will keep
  * allocating memory that we never release. Not good.
  */
-static struct dm_config_tree *lock_vg(lvmetad_state *s, const char *id) {
+static vg_metadata *lock_vg(lvmetad_state *s, const char *id) {
 	pthread_mutex_t *vg;
-	struct dm_config_tree *cft;
+	vg_metadata *meta;
 
 	lock_vgid_to_metadata(s);
 	vg = dm_hash_lookup(s->lock.vg, id);
@@ -100,9 +132,9 @@ static struct dm_config_tree *lock_vg(lvmetad_state *s, const char *id) {
 	}
 	// debug("lock VG %s\n", id);
 	pthread_mutex_lock(vg);
-	cft = dm_hash_lookup(s->vgid_to_metadata, id);
+	meta = dm_hash_lookup(s->vgid_to_metadata, id);
 	unlock_vgid_to_metadata(s);
-	return cft;
+	return meta;
 }
 
 static void unlock_vg(lvmetad_state *s, const char *id) {
@@ -124,6 +156,93 @@ static struct dm_config_node *pvs(struct dm_config_node *vg)
 	return pv;
 }
 
+static int append_text_line(const char *line, void *baton)
+{
+	struct dm_pool *mem = baton;
+
+	/* Indentation carries no information, so do not store it. */
+	while (*line == '\t')
+		++line;
+
+	if (!dm_pool_grow_object(mem, line, strlen(line)) ||
+	    !dm_pool_grow_object(mem, "\n", 1))
+		return 0;
+
+	return 1;
+}
+
+static void destroy_vg_metadata(vg_metadata *vg)
+{
+	if (vg)
+		dm_pool_destroy(vg->mem);
+}
+
+/* Pack a (filtered) metadata node into its compact form. */
+static vg_metadata *make_vg_metadata(struct dm_config_node *metadata, const char *name)
+{
+	struct dm_pool *mem, *scratch = NULL;
+	struct dm_config_node *pv;
+	const char *str;
+	char *text;
+	vg_metadata *vg;
+	unsigned i = 0;
+
+	if (!(mem = dm_pool_create("vg_metadata", 1024)))
+		return NULL;
+
+	if (!(vg = dm_pool_zalloc(mem, sizeof(*vg))))
+		goto bad;
+
+	vg->mem = mem;
+	vg->seqno = dm_config_find_int(metadata, "metadata/seqno", -1);
+
+	if ((str = dm_config_find_str(metadata, "metadata/id", NULL)) &&
+	    !(vg->vgid = dm_pool_strdup(mem, str)))
+		goto bad;
+
+	if (name && !(vg->name = dm_pool_strdup(mem, name)))
+		goto bad;
+
+	for (pv = pvs(metadata); pv; pv = pv->sib)
+		++vg->pv_count;
+
+	if (!(vg->pvids = dm_pool_zalloc(mem, sizeof(*vg->pvids) * (vg->pv_count + 1))))
+		goto bad;
+
+	for (pv = pvs(metadata); pv; pv = pv->sib)
+		if ((str = dm_config_find_str(pv->child, "id", NULL)) &&
+		    !(vg->pvids[i++] = dm_pool_strdup(mem, str)))
+			goto bad;
+	vg->pv_count = i;
+
+	/*
+	 * Format in a scratch pool: growing the object leaves the outgrown
+	 * chunks behind, so only the final text is copied to the VG pool.
+	 */
+	if (!(scratch = dm_pool_create("vg_metadata_text", 65536)) ||
+	    !dm_pool_begin_object(scratch, 65536))
+		goto bad;
+
+	if (!dm_config_write_node(metadata, append_text_line, scratch) ||
+	    !dm_pool_grow_object(scratch, "\0", 1))
+		goto bad;
+
+	text = dm_pool_end_object(scratch);
+	vg->text_size = strlen(text);
+	if (!(vg->text = dm_pool_alloc(mem, vg->text_size + 1)))
+		goto bad;
+	memcpy((char *) vg->text, text, vg->text_size + 1);
+
+	dm_pool_destroy(scratch);
+
+	return vg;
+bad:
+	if (scratch)
+		dm_pool_destroy(scratch);
+	dm_pool_destroy(mem);
+	return NULL;
+}
+
 /*
  * TODO: This set_flag function is pretty generic and might make sense in a
  * library here or there.
@@ -182,6 +301,62 @@ static int set_flag(struct dm_config_tree *cft, struct dm_config_node *parent,
 	return 1;
 }
 
+/*
+ * Queue a notification for every subscriber. The format gives the body of the
+ * message, one "key = value" line each.
+ */
+__attribute__ ((format(printf, 2, 3)))
+static void notify(lvmetad_state *s, const char *fmt, ...)
+{
+	char msg[512];
+	subscriber *sub;
+	size_t new_size;
+	char *new;
+	va_list ap;
+	int len;
+
+	pthread_mutex_lock(&s->lock.subscribers);
+	if (dm_list_empty(&s->subscribers))
+		goto out;
+
+	va_start(ap, fmt);
+	len = vsnprintf(msg, sizeof(msg) - 4, fmt, ap);
+	va_end(ap);
+
+	if (len < 0 || len >= (int) sizeof(msg) - 4) {
+		debug("notification too long, dropped\n");
+		goto out;
+	}
+	memcpy(msg + len, "\n##\n", 4);
+	len += 4;
+
+	dm_list_iterate_items(sub, &s->subscribers) {
+		if (sub->overflow)
+			continue;
+
+		if (sub->queue_used + len > sub->queue_size) {
+			new_size = sub->queue_size ? sub->queue_size * 2 : 4096;
+			while (new_size < sub->queue_used + len)
+				new_size *= 2;
+			if (new_size > SUBSCRIBER_QUEUE_MAX ||
+			    !(new = realloc(sub->queue, new_size))) {
+				sub->overflow = 1;
+				goto wake;
+			}
+			sub->queue = new;
+			sub->queue_size = new_size;
+		}
+
+		memcpy(sub->queue + sub->queue_used, msg, len);
+		sub->queue_used += len;
+	wake:
+		if (!sub->woken && write(sub->wake[1], "", 1) == 1)
+			sub->woken = 1;
+	}
+out:
+	pthread_mutex_unlock(&s->lock.subscribers);
+}
+
 static struct dm_config_node *make_config_node(struct dm_config_tree *cft,
 					       const char *key,
 					       struct dm_config_node *parent,
@@ -228,7 +403,6 @@ static struct dm_config_node *make_text_node(struct dm_config_tree *cft,
 	return cn;
 }
 
-#if 0
 static struct dm_config_node *make_int_node(struct dm_config_tree *cft,
 					    const char *key,
 					    int64_t value,
@@ -245,7 +419,6 @@ static struct dm_config_node *make_int_node(struct dm_config_tree *cft,
 	cn->v->v.i = value;
 	return cn;
 }
-#endif
 
 static void filter_metadata(struct dm_config_node *vg) {
 	struct dm_config_node *pv = pvs(vg);
@@ -322,6 +495,23 @@ static int update_pv_status(lvmetad_state *s,
 	return complete;
 }
 
+/* Like update_pv_status without act, for the stored compact form. */
+static int vg_complete(lvmetad_state *s, vg_metadata *vg)
+{
+	unsigned i;
+	int complete = 1;
+
+	lock_pvid_to_pvmeta(s);
+	for (i = 0; i < vg->pv_count; i++)
+		if (!dm_hash_lookup(s->pvid_to_pvmeta, vg->pvids[i])) {
+			complete = 0;
+			break;
+		}
+	unlock_pvid_to_pvmeta(s);
+
+	return complete;
+}
+
 static struct dm_config_node *make_pv_node(lvmetad_state *s, const char *pvid,
 					   struct dm_config_tree *cft,
 					   struct dm_config_node *parent,
@@ -500,7 +690,7 @@ bad:
 
 static response vg_lookup(lvmetad_state *s, request r)
 {
-	struct dm_config_tree *cft;
+	vg_metadata *vg;
 	struct dm_config_node *metadata, *n;
 	response res = { .buffer = NULL };
 
@@ -523,14 +713,16 @@ static response vg_lookup(lvmetad_state *s, request r)
 	if (!uuid)
 		return daemon_reply_simple("unknown", "reason = %s", "VG not found", NULL);
 
-	cft = lock_vg(s, uuid);
-	if (!cft || !cft->root) {
+	vg = lock_vg(s, uuid);
+	if (!vg) {
 		unlock_vg(s, uuid);
 		return daemon_reply_simple("unknown", "reason = %s", "UUID not found", NULL);
 	}
 
-	metadata = cft->root;
-	if (!(res.cft = dm_config_create()))
+	/* Materialize the metadata section straight into the response. */
+	if (!(res.cft = dm_config_create()) ||
+	    !dm_config_parse(res.cft, vg->text, vg->text + vg->text_size) ||
+	    !(metadata = res.cft->root))
 		goto bad;
 
 	/* The response field */
@@ -548,8 +740,7 @@ static response vg_lookup(lvmetad_state *s, request r)
 	n->v->v.str = name;
 
 	/* The metadata section */
-	if (!(n = n->sib = dm_config_clone_node(res.cft, metadata, 1)))
-		goto bad;
+	n = n->sib = metadata;
 	n->parent = res.cft->root;
 	res.error = 0;
 	unlock_vg(s, uuid);
@@ -559,69 +750,172 @@ static response vg_lookup(lvmetad_state *s, request r)
 	return res;
 bad:
 	unlock_vg(s, uuid);
+	if (res.cft)
+		dm_config_destroy(res.cft);
 	return daemon_reply_simple("failed", "reason = %s", "Out of memory", NULL);
 }
 
-static int compare_value(struct dm_config_value *a, struct dm_config_value *b)
+/*
+ * Look up a whole list of VGs in one request, so that a client can load all
+ * of them without a round trip per VG. Each VG known to lvmetad is returned as
+ * volume_groups/<uuid> with the same "name" and "metadata" nodes vg_lookup
+ * replies with, and the VG's "generation", which vg_check compares to tell the
+ * client whether that is still current. Unknown UUIDs are left out.
+ */
+static response vg_lookup_many(lvmetad_state *s, request r)
 {
-	int r = 0;
+	struct dm_config_node *uuids = dm_config_find_node(r.cft->root, "uuids");
+	struct dm_config_node *cn_vgs, *cn_last = NULL, *cn, *metadata, *root;
+	struct dm_config_value *v;
+	response res = { .buffer = NULL };
+	vg_metadata *vg;
+	const char *uuid, *name;
 
-	if (a->type > b->type)
-		return 1;
-	if (a->type < b->type)
-		return -1;
-
-	switch (a->type) {
-	case DM_CFG_STRING: r = strcmp(a->v.str, b->v.str); break;
-	case DM_CFG_FLOAT: r = (a->v.f == b->v.f) ? 0 : (a->v.f > b->v.f) ? 1 : -1; break;
-	case DM_CFG_INT: r = (a->v.i == b->v.i) ? 0 : (a->v.i > b->v.i) ? 1 : -1; break;
-	case DM_CFG_EMPTY_ARRAY: return 0;
+	if (!(res.cft = dm_config_create()) ||
+	    !(res.cft->root = make_text_node(res.cft, "response", "OK", NULL, NULL)) ||
+	    !(cn_vgs = make_config_node(res.cft, "volume_groups", NULL, res.cft->root)))
+		goto bad;
+
+	for (v = uuids ? uuids->v : NULL; v; v = v->next) {
+		if (v->type != DM_CFG_STRING)
+			continue;
+
+		if (!(uuid = dm_pool_strdup(res.cft->mem, v->v.str)))
+			goto bad;
+
+		lock_vgid_to_metadata(s);
+		name = dm_hash_lookup(s->vgid_to_vgname, uuid);
+		name = name ? dm_pool_strdup(res.cft->mem, name) : NULL;
+		unlock_vgid_to_metadata(s);
+
+		debug("vg_lookup_many: uuid = %s, name = %s\n", uuid, name);
+
+		if (!name)
+			continue;
+
+		if (!(vg = lock_vg(s, uuid))) {
+			unlock_vg(s, uuid);
+			continue;
+		}
+
+		/* dm_config_parse replaces the root; put ours back afterwards. */
+		root = res.cft->root;
+		if (!dm_config_parse(res.cft, vg->text, vg->text + vg->text_size)) {
+			res.cft->root = root;
+			unlock_vg(s, uuid);
+			goto bad;
+		}
+		metadata = res.cft->root;
+		res.cft->root = root;
+
+		if (!(cn = make_config_node(res.cft, uuid, cn_vgs, cn_last)) ||
+		    !make_text_node(res.cft, "name", name, cn, NULL) ||
+		    !make_int_node(res.cft, "generation", (int64_t) vg->generation,
+				   cn, cn->child)) {
+			unlock_vg(s, uuid);
+			goto bad;
+		}
+
+		cn->child->sib->sib = metadata;
+		metadata->parent = cn;
+		cn_last = cn;
+
+		update_pv_status(s, res.cft, metadata, 1); /* FIXME report errors */
+		unlock_vg(s, uuid);
 	}
 
-	if (r == 0 && a->next && b->next)
-		r = compare_value(a->next, b->next);
-	return r;
+	return res;
+bad:
+	if (res.cft)
+		dm_config_destroy(res.cft);
+	return daemon_reply_simple("failed", "reason = %s", "Out of memory", NULL);
 }
 
+/*
+ * Cheap check that a VG is still as a vg_lookup_many returned it: "OK" if its
+ * generation is the same, "changed" otherwise, when the client needs to do a
+ * full vg_lookup.
+ */
+static response vg_check(lvmetad_state *s, request r)
+{
+	const char *uuid = daemon_request_str(r, "uuid", NULL);
+	int64_t generation = daemon_request_int(r, "generation", -1);
+	vg_metadata *vg;
+	int same;
+
+	if (!uuid)
+		return daemon_reply_simple("failed", "reason = %s", "need VG UUID", NULL);
+
+	vg = lock_vg(s, uuid);
+	same = vg && generation >= 0 && (uint64_t) generation == vg->generation;
+	unlock_vg(s, uuid);
+
+	debug("vg_check %s: %s\n", uuid, same ? "unchanged" : "changed");
+
+	if (!vg)
+		return daemon_reply_simple("unknown", "reason = %s", "UUID not found", NULL);
+
+	return daemon_reply_simple(same ? "OK" : "changed", NULL);
+}
+
+static int compare_value(struct dm_config_value *a, struct dm_config_value *b)
+{
+	for (; a && b; a = a->next, b = b->next) {
+		if (a->type != b->type)
+			return 1;
+
+		switch (a->type) {
+		case DM_CFG_STRING:
+			if (strcmp(a->v.str, b->v.str))
+				return 1;
+			break;
+		case DM_CFG_FLOAT:
+			if (a->v.f != b->v.f)
+				return 1;
+			break;
+		case DM_CFG_INT:
+			if (a->v.i != b->v.i)
+				return 1;
+			break;
+		case DM_CFG_EMPTY_ARRAY:
+			break;
+		}
+	}
+
+	return (a || b) ? 1 : 0;
+}
+
+/* Compare two nodes including all their children, but not their siblings. */
 static int compare_config(struct dm_config_node *a, struct dm_config_node *b)
 {
-	int result = 0;
-	if (a->v && b->v)
-		result = compare_value(a->v, b->v);
-	if (a->v && !b->v)
-		result = 1;
-	if (!a->v && b->v)
-		result = -1;
-	if (a->child && b->child)
-		result = compare_config(a->child, b->child);
-
-	if (result) {
+	struct dm_config_node *ca, *cb;
+
+	if (strcmp(a->key, b->key) ||
+	    (a->v && b->v && compare_value(a->v, b->v)) ||
+	    (!a->v != !b->v)) {
 		debug("config inequality at %s / %s\n", a->key, b->key);
-		return result;
+		return 1;
 	}
 
-	if (a->sib && b->sib)
-		result = compare_config(a->sib, b->sib);
-	if (a->sib && !b->sib)
-		result = 1;
-	if (!a->sib && b->sib)
-		result = -1;
+	for (ca = a->child, cb = b->child; ca && cb; ca = ca->sib, cb = cb->sib)
+		if (compare_config(ca, cb))
+			return 1;
 
-	return result;
+	return (ca || cb) ? 1 : 0;
 }
 
 static int vg_remove_if_missing(lvmetad_state *s, const char *vgid);
 
 /* You need to be holding the pvid_to_vgid lock already to call this. */
-static int update_pvid_to_vgid(lvmetad_state *s, struct dm_config_tree *vg,
+static int update_pvid_to_vgid(lvmetad_state *s, vg_metadata *vg,
 			       const char *vgid, int nuke_empty)
 {
-	struct dm_config_node *pv;
 	struct dm_hash_table *to_check;
 	struct dm_hash_node *n;
 	const char *pvid;
 	const char *vgid_old;
 	const char *check_vgid;
+	unsigned i;
 	int r = 0;
 
 	if (!vgid)
@@ -630,9 +924,8 @@ static int update_pvid_to_vgid(lvmetad_state *s, struct dm_config_tree *vg,
 	if (!(to_check = dm_hash_create(32)))
 		return 0;
 
-	for (pv = pvs(vg->root); pv; pv = pv->sib) {
-		if (!(pvid = dm_config_find_str(pv->child, "id", NULL)))
-			continue;
+	for (i = 0; i < vg->pv_count; i++) {
+		pvid = vg->pvids[i];
 
 		if (nuke_empty &&
 		    (vgid_old = dm_hash_lookup(s->pvid_to_vgid, pvid)) &&
@@ -663,7 +956,7 @@ static int update_pvid_to_vgid(lvmetad_state *s, struct dm_config_tree *vg,
 /* A pvid map lock needs to be held if update_pvids = 1. */
 static int remove_metadata(lvmetad_state *s, const char *vgid, int update_pvids)
 {
-	struct dm_config_tree *old;
+	vg_metadata *old;
 	const char *oldname;
 	lock_vgid_to_metadata(s);
 	old = dm_hash_lookup(s->vgid_to_metadata, vgid);
@@ -681,17 +974,17 @@ static int remove_metadata(lvmetad_state *s, const char *vgid, int update_pvids)
 	dm_hash_remove(s->vgid_to_metadata, vgid);
 	dm_hash_remove(s->vgid_to_vgname, vgid);
 	dm_hash_remove(s->vgname_to_vgid, oldname);
-	dm_config_destroy(old);
+	destroy_vg_metadata(old);
 	return 1;
 }
 
 /* The VG must be locked. */
 static int vg_remove_if_missing(lvmetad_state *s, const char *vgid)
 {
-	struct dm_config_tree *vg;
-	struct dm_config_node *pv;
+	vg_metadata *vg;
 	const char *vgid_check;
 	const char *pvid;
+	unsigned i;
 	int missing = 1;
 
 	if (!vgid)
@@ -701,9 +994,8 @@ static int vg_remove_if_missing(lvmetad_state *s, const char *vgid)
 		return 1;
 
 	lock_pvid_to_pvmeta(s);
-	for (pv = pvs(vg->root); pv; pv = pv->sib) {
-		if (!(pvid = dm_config_find_str(pv->child, "id", NULL)))
-			continue;
+	for (i = 0; i < vg->pv_count; i++) {
+		pvid = vg->pvids[i];
 
 		if ((vgid_check = dm_hash_lookup(s->pvid_to_vgid, pvid)) &&
 		    dm_hash_lookup(s->pvid_to_pvmeta, pvid) &&
@@ -713,7 +1005,8 @@ static int vg_remove_if_missing(lvmetad_state *s, const char *vgid)
 
 	if (missing) {
 		debug("nuking VG %s\n", vgid);
-		remove_metadata(s, vgid, 0);
+		if (remove_metadata(s, vgid, 0))
+			notify(s, "notification = \"vg_remove\"\nvgid = \"%s\"\n", vgid);
 	}
 
 	unlock_pvid_to_pvmeta(s);
@@ -727,14 +1020,13 @@ static int vg_remove_if_missing(lvmetad_state *s, const char *vgid)
 static int update_metadata(lvmetad_state *s, const char *name, const char *_vgid,
 			   struct dm_config_node *metadata)
 {
-	struct dm_config_tree *cft;
-	struct dm_config_tree *old;
+	vg_metadata *vg = NULL, *new;
+	vg_metadata *old;
 	int retval = 0;
 	int seq;
 	int haveseq = -1;
 	const char *oldname = NULL;
 	const char *vgid;
-	char *cfgname;
 
 	lock_vgid_to_metadata(s);
 	old = dm_hash_lookup(s->vgid_to_metadata, _vgid);
@@ -744,7 +1036,7 @@ static int update_metadata(lvmetad_state *s, const char *name, const char *_vgid
 	seq = dm_config_find_int(metadata, "metadata/seqno", -1);
 
 	if (old) {
-		haveseq = dm_config_find_int(old->root, "metadata/seqno", -1);
+		haveseq = old->seqno;
 		oldname = dm_hash_lookup(s->vgid_to_vgname, _vgid);
 		assert(oldname);
 	}
@@ -754,19 +1046,6 @@ static int update_metadata(lvmetad_state *s, const char *name, const char *_vgid
 
 	filter_metadata(metadata); /* sanitize */
 
-	if (seq == haveseq) {
-		retval = 1;
-		if (compare_config(metadata, old->root))
-			retval = 0;
-		debug("Not updating metadata for %s at %d (%s)\n", _vgid, haveseq,
-		      retval ? "ok" : "MISMATCH");
-		if (!retval) {
-			debug_cft("OLD: ", old->root);
-			debug_cft("NEW: ", metadata);
-		}
-		goto out;
-	}
-
 	if (seq < haveseq) {
 		debug("Refusing to update metadata for %s at %d to %d\n", _vgid, haveseq, seq);
 		/* TODO: notify the client that their metadata is out of date? */
@@ -774,13 +1053,22 @@ static int update_metadata(lvmetad_state *s, const char *name, const char *_vgid
 		goto out;
 	}
 
-	if (!(cft = dm_config_create()) ||
-	    !(cft->root = dm_config_clone_node(cft, metadata, 0))) {
+	if (!(vg = make_vg_metadata(metadata, name))) {
 		debug("Out of memory\n");
 		goto out;
 	}
 
-	vgid = dm_config_find_str(cft->root, "metadata/id", NULL);
+	if (seq == haveseq) {
+		retval = (vg->text_size == old->text_size &&
+			  !memcmp(vg->text, old->text, vg->text_size)) ? 1 : 0;
+		debug("Not updating metadata for %s at %d (%s)\n", _vgid, haveseq,
+		      retval ? "ok" : "MISMATCH");
+		if (!retval)
+			debug("OLD:\n%s\nNEW:\n%s\n", old->text, vg->text);
+		goto out;
+	}
+
+	vgid = vg->vgid;
 
 	if (!vgid || !name) {
 		debug("Name '%s' or uuid '%s' missing!\n", name, vgid);
@@ -798,22 +1086,61 @@ static int update_metadata(lvmetad_state *s, const char *name, const char *_vgid
 	lock_vgid_to_metadata(s);
 	debug("Mapping %s to %s\n", vgid, name);
 
-	retval = ((cfgname = dm_pool_strdup(dm_config_memory(cft), name)) &&
-		  dm_hash_insert(s->vgid_to_metadata, vgid, cft) &&
-		  dm_hash_insert(s->vgid_to_vgname, vgid, cfgname) &&
+	new = vg;
+	vg = NULL; /* owned by vgid_to_metadata from here on */
+	new->generation = ++s->generation;
+	retval = (dm_hash_insert(s->vgid_to_metadata, vgid, new) &&
+		  dm_hash_insert(s->vgid_to_vgname, vgid, (void*) new->name) &&
 		  dm_hash_insert(s->vgname_to_vgid, name, (void*) vgid)) ? 1 : 0;
 	unlock_vgid_to_metadata(s);
 
 	if (retval)
 		/* FIXME: What should happen when update fails */
-		retval = update_pvid_to_vgid(s, cft, vgid, 1);
+		retval = update_pvid_to_vgid(s, new, vgid, 1);
 
 	unlock_pvid_to_vgid(s);
+
+	if (retval)
+		notify(s, "notification = \"vg_update\"\nvgid = \"%s\"\n"
+		       "name = \"%s\"\nseqno = %d\n", vgid, new->name, seq);
 out:
+	destroy_vg_metadata(vg);
 	unlock_vg(s, _vgid);
 	return retval;
 }
 
+/*
+ * Give the VG a new generation after anything vg_lookup reports about it
+ * changed without new metadata: the PVs that are present and their pvmeta.
+ */
+static void vg_changed(lvmetad_state *s, const char *vgid)
+{
+	vg_metadata *vg;
+
+	if ((vg = lock_vg(s, vgid))) {
+		lock_vgid_to_metadata(s);
+		vg->generation = ++s->generation;
+		unlock_vgid_to_metadata(s);
+	}
+	unlock_vg(s, vgid);
+}
+
+/* The same for the VG the PV belongs to, if any. */
+static void pv_changed(lvmetad_state *s, const char *pvid)
+{
+	const char *vgid;
+	char vgid_buf[64];
+
+	lock_pvid_to_vgid(s);
+	if ((vgid = dm_hash_lookup(s->pvid_to_vgid, pvid)) &&
+	    !dm_strncpy(vgid_buf, vgid, sizeof(vgid_buf)))
+		vgid = NULL;
+	unlock_pvid_to_vgid(s);
+
+	if (vgid && strcmp(vgid_buf, "#orphan"))
+		vg_changed(s, vgid_buf);
+}
+
 static response pv_gone(lvmetad_state *s, request r)
 {
 	const char *pvid = daemon_request_str(r, "uuid", NULL);
@@ -839,12 +1166,37 @@ static response pv_gone(lvmetad_state *s, request r)
 	unlock_pvid_to_pvmeta(s);
 
 	if (pvmeta) {
+		pv_changed(s, pvid);
+		notify(s, "notification = \"pv_gone\"\npvid = \"%s\"\n"
+		       "device = %" PRIu64 "\n", pvid, device);
 		dm_config_destroy(pvmeta);
 		return daemon_reply_simple("OK", NULL);
 	} else
 		return daemon_reply_simple("unknown", "reason = %s", "PVID does not exist", NULL);
 }
 
+/*
+ * Drop the MDA fingerprint (location, size and checksum of the metadata) from
+ * the pvmeta stored for a PV whose metadata lvmetad did not take, so that
+ * pv_check answers "changed" and the metadata keeps being sent (and refused).
+ */
+static void forget_mda_fingerprint(lvmetad_state *s, const char *pvid)
+{
+	struct dm_config_tree *pvmeta;
+	struct dm_config_node *mda, **item;
+
+	lock_pvid_to_pvmeta(s);
+	if ((pvmeta = dm_hash_lookup(s->pvid_to_pvmeta, pvid)))
+		for (mda = pvmeta->root->child; mda; mda = mda->sib)
+			for (item = &mda->child; *item; ) {
+				if (!strncmp((*item)->key, "metadata_", 9))
+					*item = (*item)->sib;
+				else
+					item = &(*item)->sib;
+			}
+	unlock_pvid_to_pvmeta(s);
+}
+
 static response pv_found(lvmetad_state *s, request r)
 {
 	struct dm_config_node *metadata = dm_config_find_node(r.cft->root, "metadata");
@@ -854,9 +1206,12 @@ static response pv_found(lvmetad_state *s, request r)
 	struct dm_config_node *pvmeta = dm_config_find_node(r.cft->root, "pvmeta");
 	uint64_t device;
 	struct dm_config_tree *cft, *pvmeta_old = NULL;
+	vg_metadata *vg;
 	const char *old;
 	const char *pvid_dup;
-	int complete = 0, orphan = 0;
+	char old_pvid[64] = "";
+	int64_t seqno = -1;
+	int complete = 0, orphan = 0, stale = 0;
 
 	if (!pvid)
 		return daemon_reply_simple("failed", "reason = %s", "need PV UUID", NULL);
@@ -873,6 +1228,8 @@ static response pv_found(lvmetad_state *s, request r)
 	if ((old = dm_hash_lookup_binary(s->device_to_pvid, &device, sizeof(device)))) {
 		pvmeta_old = dm_hash_lookup(s->pvid_to_pvmeta, old);
 		dm_hash_remove(s->pvid_to_pvmeta, old);
+		if (strcmp(old, pvid) && !dm_strncpy(old_pvid, old, sizeof(old_pvid)))
+			*old_pvid = 0;
 	}
 
 	if (!(cft = dm_config_create()) ||
@@ -892,18 +1249,24 @@ static response pv_found(lvmetad_state *s, request r)
 
 	unlock_pvid_to_pvmeta(s);
 
+	pv_changed(s, pvid);
+	if (*old_pvid)
+		pv_changed(s, old_pvid);
+
 	if (metadata) {
 		if (!vgid)
 			return daemon_reply_simple("failed", "reason = %s", "need VG UUID", NULL);
 		debug("obtained vgid = %s, vgname = %s\n", vgid, vgname);
 		if (!vgname)
 			return daemon_reply_simple("failed", "reason = %s", "need VG name", NULL);
-		if (daemon_request_int(r, "metadata/seqno", -1) < 0)
+		if ((seqno = daemon_request_int(r, "metadata/seqno", -1)) < 0)
 			return daemon_reply_simple("failed", "reason = %s", "need VG seqno", NULL);
 
-		if (!update_metadata(s, vgname, vgid, metadata))
+		if (!update_metadata(s, vgname, vgid, metadata)) {
+			forget_mda_fingerprint(s, pvid);
 			return daemon_reply_simple("failed", "reason = %s",
 						   "metadata update failed", NULL);
+		}
 	} else {
 		lock_pvid_to_vgid(s);
 		vgid = dm_hash_lookup(s->pvid_to_vgid, pvid);
@@ -911,9 +1274,11 @@ static response pv_found(lvmetad_state *s, request r)
 	}
 
 	if (vgid) {
-		if ((cft = lock_vg(s, vgid)))
-			complete = update_pv_status(s, cft, cft->root, 0);
-		else if (!strcmp(vgid, "#orphan"))
+		if ((vg = lock_vg(s, vgid))) {
+			complete = vg_complete(s, vg);
+			/* update_metadata refused metadata older than it has */
+			stale = metadata && vg->seqno != seqno;
+		} else if (!strcmp(vgid, "#orphan"))
 			orphan = 1;
 		else {
 			unlock_vg(s, vgid);
@@ -924,6 +1289,12 @@ static response pv_found(lvmetad_state *s, request r)
 		unlock_vg(s, vgid);
 	}
 
+	if (stale)
+		forget_mda_fingerprint(s, pvid);
+
+	notify(s, "notification = \"pv_found\"\npvid = \"%s\"\n"
+	       "device = %" PRIu64 "\nvgid = \"%s\"\n", pvid, device, vgid ? vgid : "#orphan");
+
 	return daemon_reply_simple("OK",
 				   "status = %s", orphan ? "orphan" :
 				                     (complete ? "complete" : "partial"),
@@ -931,6 +1302,57 @@ static response pv_found(lvmetad_state *s, request r)
 				   NULL);
 }
 
+/*
+ * Cheap check that a PV is still as lvmetad last saw it: the pvmeta (which
+ * includes the location, size and checksum of the metadata in each of its
+ * MDAs) is the same one a full pv_found stored (pv_found does not keep the
+ * MDA part for metadata it refused), and the PV still belongs to a known VG. If so, the reply is what pv_found would have said; otherwise
+ * the response is "changed" and the client needs to send the full pv_found.
+ */
+static response pv_check(lvmetad_state *s, request r)
+{
+	struct dm_config_node *pvmeta = dm_config_find_node(r.cft->root, "pvmeta");
+	const char *pvid = daemon_request_str(r, "pvmeta/id", NULL);
+	struct dm_config_tree *old;
+	const char *old_pvid, *vgid;
+	char vgid_buf[64];
+	uint64_t device;
+	vg_metadata *vg;
+	int same, complete = 0;
+
+	if (!pvid || !pvmeta || !dm_config_get_uint64(pvmeta, "pvmeta/device", &device))
+		return daemon_reply_simple("failed", "reason = %s", "need PV metadata", NULL);
+
+	lock_pvid_to_pvmeta(s);
+	old = dm_hash_lookup(s->pvid_to_pvmeta, pvid);
+	old_pvid = dm_hash_lookup_binary(s->device_to_pvid, &device, sizeof(device));
+	same = old && old_pvid && !strcmp(old_pvid, pvid) && !compare_config(old->root, pvmeta);
+	unlock_pvid_to_pvmeta(s);
+
+	lock_pvid_to_vgid(s);
+	vgid = same ? dm_hash_lookup(s->pvid_to_vgid, pvid) : NULL;
+	if (vgid && !dm_strncpy(vgid_buf, vgid, sizeof(vgid_buf)))
+		vgid = NULL;
+	unlock_pvid_to_vgid(s);
+
+	if (vgid && strcmp(vgid_buf, "#orphan")) {
+		if ((vg = lock_vg(s, vgid_buf)))
+			complete = vg_complete(s, vg);
+		unlock_vg(s, vgid_buf);
+	} else
+		vg = NULL;
+
+	debug("pv_check %s, device = %" PRIu64 ": %s\n", pvid, device, vg ? "unchanged" : "changed");
+
+	if (!vg)
+		return daemon_reply_simple("changed", NULL);
+
+	return daemon_reply_simple("OK",
+				   "status = %s", complete ? "complete" : "partial",
+				   "vgid = %s", vgid_buf,
+				   NULL);
+}
+
 static response vg_update(lvmetad_state *s, request r)
 {
 	struct dm_config_node *metadata = dm_config_find_node(r.cft->root, "metadata");
@@ -963,12 +1385,103 @@ static response vg_remove(lvmetad_state *s, request r)
 	fprintf(stderr, "vg_remove: %s\n", vgid);
 
 	lock_pvid_to_vgid(s);
-	remove_metadata(s, vgid, 1);
+	if (remove_metadata(s, vgid, 1))
+		notify(s, "notification = \"vg_remove\"\nvgid = \"%s\"\n", vgid);
 	unlock_pvid_to_vgid(s);
 
 	return daemon_reply_simple("OK", NULL);
 }
 
+/*
+ * Turn the connection into a stream of change notifications, one message per
+ * change, after the initial "OK":
+ *
+ *   notification = "vg_update", with vgid, name and the new seqno
+ *   notification = "vg_remove", with vgid
+ *   notification = "pv_found", with pvid, device and vgid ("#orphan" if none)
+ *   notification = "pv_gone", with pvid and device
+ *   notification = "overflow": notifications were lost, refetch everything
+ *
+ * The client does not send any more requests on this connection; closing it
+ * ends the subscription.
+ */
+static response subscribe(lvmetad_state *s, client_handle h)
+{
+	/* write_buffer terminates each message. */
+	static const char ok[] = "response = \"OK\"\n";
+	static const char overflow[] = "notification = \"overflow\"\n";
+	subscriber sub = { .queue = NULL };
+	struct pollfd pfd[2];
+	char *queue, drain[64];
+	size_t queue_used;
+	int lost, r;
+
+	if (pipe(sub.wake))
+		return daemon_reply_simple("failed", "reason = %s", "cannot create pipe", NULL);
+
+	pthread_mutex_lock(&s->lock.subscribers);
+	dm_list_add(&s->subscribers, &sub.list);
+	pthread_mutex_unlock(&s->lock.subscribers);
+
+	debug("subscribe: client %d\n", h.socket_fd);
+
+	if (!write_buffer(h.socket_fd, ok, sizeof(ok) - 1))
+		goto out;
+
+	while (1) {
+		pfd[0].fd = h.socket_fd;
+		pfd[0].events = POLLIN;
+		pfd[1].fd = sub.wake[0];
+		pfd[1].events = POLLIN;
+
+		if (poll(pfd, 2, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		/* Anything the client sends is ignored; EOF ends the subscription. */
+		if (pfd[0].revents) {
+			r = read(h.socket_fd, drain, sizeof(drain));
+			if (!r || (r < 0 && errno != EINTR && errno != EAGAIN))
+				break;
+		}
+
+		if (!(pfd[1].revents & POLLIN))
+			continue;
+
+		pthread_mutex_lock(&s->lock.subscribers);
+		if (read(sub.wake[0], drain, 1) == 1)
+			sub.woken = 0;
+		queue = sub.queue;
+		queue_used = sub.queue_used;
+		lost = sub.overflow;
+		sub.queue = NULL;
+		sub.queue_used = sub.queue_size = 0;
+		sub.overflow = 0;
+		pthread_mutex_unlock(&s->lock.subscribers);
+
+		/* The queue ends with a terminator, which write_buffer adds back. */
+		r = (!queue_used || write_buffer(h.socket_fd, queue, queue_used - 4)) &&
+		    (!lost || write_buffer(h.socket_fd, overflow, sizeof(overflow) - 1));
+		free(queue);
+		if (!r)
+			break;
+	}
+out:
+	pthread_mutex_lock(&s->lock.subscribers);
+	dm_list_del(&sub.list);
+	pthread_mutex_unlock(&s->lock.subscribers);
+
+	debug("unsubscribe: client %d\n", h.socket_fd);
+
+	(void) close(sub.wake[0]);
+	(void) close(sub.wake[1]);
+	free(sub.queue);
+
+	return daemon_reply_simple("failed", "reason = %s", "subscription ended", NULL);
+}
+
 static response handler(daemon_state s, client_handle h, request r)
 {
 	lvmetad_state *state = s.private;
@@ -984,6 +1497,9 @@ static response handler(daemon_state s, client_handle h, request r)
 	if (!strcmp(rq, "pv_gone"))
 		return pv_gone(state, r);
 
+	if (!strcmp(rq, "pv_check"))
+		return pv_check(state, r);
+
 	if (!strcmp(rq, "pv_lookup"))
 		return pv_lookup(state, r);
 
@@ -996,6 +1512,12 @@ static response handler(daemon_state s, client_handle h, request r)
 	if (!strcmp(rq, "vg_lookup"))
 		return vg_lookup(state, r);
 
+	if (!strcmp(rq, "vg_lookup_many"))
+		return vg_lookup_many(state, r);
+
+	if (!strcmp(rq, "vg_check"))
+		return vg_check(state, r);
+
 	if (!strcmp(rq, "pv_list")) {
 		return pv_list(state, r);
 	}
@@ -1003,6 +1525,9 @@ static response handler(daemon_state s, client_handle h, request r)
 	if (!strcmp(rq, "vg_list"))
 		return vg_list(state, r);
 
+	if (!strcmp(rq, "subscribe"))
+		return subscribe(state, h);
+
 	return daemon_reply_simple("failed", "reason = %s", "no such request", NULL);
 }
 
@@ -1023,6 +1548,8 @@ static int init(daemon_state *s)
 	pthread_mutex_init(&ls->lock.pvid_to_pvmeta, &rec);
 	pthread_mutex_init(&ls->lock.vgid_to_metadata, &rec);
 	pthread_mutex_init(&ls->lock.pvid_to_vgid, NULL);
+	pthread_mutex_init(&ls->lock.subscribers, NULL);
+	dm_list_init(&ls->subscribers);
 
 	debug("initialised state: vgid_to_metadata = %p\n", ls->vgid_to_metadata);
 	if (!ls->pvid_to_vgid || !ls->vgid_to_metadata)
@@ -1041,7 +1568,7 @@ static int fini(daemon_state *s)
 
 	debug("fini\n");
 	while (n) {
-		dm_config_destroy(dm_hash_get_data(ls->vgid_to_metadata, n));
+		destroy_vg_metadata(dm_hash_get_data(ls->vgid_to_metadata, n));
 		n = dm_hash_get_next(ls->vgid_to_metadata, n);
 	}
 
@@ -33,6 +33,7 @@
 #include <limits.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/time.h>
 
 #define _skip(fmt, args...) log_very_verbose("Skipping: " fmt , ## args)
 
@@ -221,7 +222,8 @@ int lv_resume_if_active(struct cmd_context *cmd, const char *lvid_s,
 {
 	return 1;
 }
-int lv_deactivate(struct cmd_context *cmd, const char *lvid_s)
+int lv_deactivate(struct cmd_context *cmd, const char *lvid_s,
+		  struct logical_volume *lv)
 {
 	return 1;
 }
@@ -234,7 +236,8 @@ int lv_activate(struct cmd_context *cmd, const char *lvid_s, int exclusive)
 {
 	return 1;
 }
-int lv_activate_with_filter(struct cmd_context *cmd, const char *lvid_s, int exclusive)
+int lv_activate_with_filter(struct cmd_context *cmd, const char *lvid_s, int exclusive,
+			    struct logical_volume *lv)
 {
 	return 1;
 }
@@ -284,6 +287,12 @@ int monitor_dev_for_events(struct cmd_context *cmd, struct logical_volume *lv,
 {
 	return 1;
 }
+void monitor_batch_begin(void)
+{
+}
+void monitor_batch_end(void)
+{
+}
 /* fs.c */
 void fs_unlock(void)
 {
@@ -328,18 +337,68 @@ int activation(void)
 	return _activation;
 }
 
-static int _passes_volumes_filter(struct cmd_context *cmd,
-				  struct logical_volume *lv,
-				  const struct dm_config_node *cn,
-				  const char *config_path)
+/*
+ * A volume_list style setting compiled for matching many LVs: vg and
+ * vg/lv entries go into one hash and tags into another, so each LV
+ * costs a few lookups however long the list is.  It is rebuilt when
+ * the configuration is reloaded.
+ */
+struct volume_list_filter {
+	const struct dm_config_node *cn;	/* Setting it was built from */
+	struct dm_pool *mem;
+	struct dm_hash_table *names;		/* vgname and vgname/lvname */
+	struct dm_hash_table *tags;		/* @tag entries */
+	struct dm_hash_table *host_tags;	/* Host tags, if @* is listed */
+};
+
+static struct volume_list_filter *_volume_list_filter = NULL;
+static struct volume_list_filter *_read_only_volume_list_filter = NULL;
+
+static void _destroy_volume_list_filter(struct volume_list_filter **vlf)
+{
+	if (!*vlf)
+		return;
+
+	if ((*vlf)->names)
+		dm_hash_destroy((*vlf)->names);
+	if ((*vlf)->tags)
+		dm_hash_destroy((*vlf)->tags);
+	if ((*vlf)->host_tags)
+		dm_hash_destroy((*vlf)->host_tags);
+	dm_pool_destroy((*vlf)->mem);
+	*vlf = NULL;
+}
+
+static struct volume_list_filter *_create_volume_list_filter(struct cmd_context *cmd,
+							      const struct dm_config_node *cn,
+							      const char *config_path)
 {
 	const struct dm_config_value *cv;
+	const struct str_list *sl;
+	struct volume_list_filter *vlf;
+	struct dm_pool *mem;
 	const char *str;
-	static char path[PATH_MAX];
+	unsigned count = 0;
 
-	log_verbose("%s configuration setting defined: "
-		    "Checking the list to match %s/%s",
-		    config_path, lv->vg->name, lv->name);
+	for (cv = cn->v; cv; cv = cv->next)
+		count++;
+
+	if (!(mem = dm_pool_create("volume_list", 512)))
+		return_NULL;
+
+	if (!(vlf = dm_pool_zalloc(mem, sizeof(*vlf)))) {
+		log_error("Failed to allocate %s filter.", config_path);
+		goto bad;
+	}
+
+	vlf->cn = cn;
+	vlf->mem = mem;
+
+	if (!(vlf->names = dm_hash_create(count + 1)) ||
+	    !(vlf->tags = dm_hash_create(count + 1))) {
+		log_error("Failed to allocate %s hash.", config_path);
+		goto bad;
+	}
 
 	for (cv = cn->v; cv; cv = cv->next) {
 		if (cv->type != DM_CFG_STRING) {
@@ -354,7 +413,6 @@ static int _passes_volumes_filter(struct cmd_context *cmd,
 			continue;
 		}
 
-
 		/* Tag? */
 		if (*str == '@') {
 			str++;
@@ -363,40 +421,92 @@ static int _passes_volumes_filter(struct cmd_context *cmd,
 					  "%s", config_path);
 				continue;
 			}
-			/* If any host tag matches any LV or VG tag, activate */
+			/* Any host tag matching any LV or VG tag */
 			if (!strcmp(str, "*")) {
-				if (str_list_match_list(&cmd->tags, &lv->tags, NULL)
-				    || str_list_match_list(&cmd->tags,
-							   &lv->vg->tags, NULL))
-					    return 1;
-				else
+				if (vlf->host_tags)
 					continue;
-			}
-			/* If supplied tag matches LV or VG tag, activate */
-			if (str_list_match_item(&lv->tags, str) ||
-			    str_list_match_item(&lv->vg->tags, str))
-				return 1;
-			else
-				continue;
-		}
-		if (!strchr(str, '/')) {
-			/* vgname supplied */
-			if (!strcmp(str, lv->vg->name))
-				return 1;
-			else
+				if (!(vlf->host_tags = dm_hash_create(16))) {
+					log_error("Failed to allocate %s hash.",
+						  config_path);
+					goto bad;
+				}
+				dm_list_iterate_items(sl, &cmd->tags)
+					if (!dm_hash_insert(vlf->host_tags, sl->str, vlf))
+						goto_bad;
 				continue;
-		}
-		/* vgname/lvname */
-		if (dm_snprintf(path, sizeof(path), "%s/%s", lv->vg->name,
-				 lv->name) < 0) {
-			log_error("dm_snprintf error from %s/%s", lv->vg->name,
-				  lv->name);
+			}
+			if (!dm_hash_insert(vlf->tags, str, vlf))
+				goto_bad;
 			continue;
 		}
-		if (!strcmp(path, str))
-			return 1;
+
+		/* vgname or vgname/lvname */
+		if (!dm_hash_insert(vlf->names, str, vlf))
+			goto_bad;
 	}
 
+	return vlf;
+
+bad:
+	if (vlf)
+		_destroy_volume_list_filter(&vlf);
+	else
+		dm_pool_destroy(mem);
+	return NULL;
+}
+
+static int _tags_in_hash(struct dm_hash_table *hash, const struct dm_list *tags)
+{
+	const struct str_list *sl;
+
+	dm_list_iterate_items(sl, tags)
+		if (dm_hash_lookup(hash, sl->str))
+			return 1;
+
+	return 0;
+}
+
+static int _passes_volumes_filter(struct cmd_context *cmd,
+				  struct logical_volume *lv,
+				  const struct dm_config_node *cn,
+				  const char *config_path,
+				  struct volume_list_filter **vlf)
+{
+	static char path[PATH_MAX];
+
+	log_verbose("%s configuration setting defined: "
+		    "Checking the list to match %s/%s",
+		    config_path, lv->vg->name, lv->name);
+
+	if (*vlf && (*vlf)->cn != cn)
+		_destroy_volume_list_filter(vlf);
+
+	if (!*vlf && !(*vlf = _create_volume_list_filter(cmd, cn, config_path)))
+		return_0;
+
+	/* If supplied tag matches LV or VG tag, activate */
+	if (_tags_in_hash((*vlf)->tags, &lv->tags) ||
+	    _tags_in_hash((*vlf)->tags, &lv->vg->tags))
+		return 1;
+
+	/* If any host tag matches any LV or VG tag, activate */
+	if ((*vlf)->host_tags &&
+	    (_tags_in_hash((*vlf)->host_tags, &lv->tags) ||
+	     _tags_in_hash((*vlf)->host_tags, &lv->vg->tags)))
+		return 1;
+
+	/* vgname supplied */
+	if (dm_hash_lookup((*vlf)->names, lv->vg->name))
+		return 1;
+
+	/* vgname/lvname */
+	if (dm_snprintf(path, sizeof(path), "%s/%s", lv->vg->name,
+			lv->name) < 0)
+		log_error("dm_snprintf error from %s/%s", lv->vg->name,
+			  lv->name);
+	else if (dm_hash_lookup((*vlf)->names, path))
+		return 1;
+
 	log_verbose("No item supplied in %s configuration setting "
 		    "matches %s/%s", config_path, lv->vg->name, lv->name);
 
@@ -429,7 +539,8 @@ static int _passes_activation_filter(struct cmd_context *cmd,
 		return 0;
 	}
 
-	return _passes_volumes_filter(cmd, lv, cn, "activation/volume_list");
+	return _passes_volumes_filter(cmd, lv, cn, "activation/volume_list",
+				      &_volume_list_filter);
 }
 
 static int _passes_readonly_filter(struct cmd_context *cmd,
@@ -440,7 +551,8 @@ static int _passes_readonly_filter(struct cmd_context *cmd,
 	if (!(cn = find_config_tree_node(cmd, "activation/read_only_volume_list")))
 		return 0;
 
-	return _passes_volumes_filter(cmd, lv, cn, "activation/read_only_volume_list");
+	return _passes_volumes_filter(cmd, lv, cn, "activation/read_only_volume_list",
+				      &_read_only_volume_list_filter);
 }
 
 int library_version(char *version, size_t size)
@@ -620,6 +732,26 @@ int lv_info(struct cmd_context *cmd, const struct logical_volume *lv, int use_la
 	return 1;
 }
 
+/*
+ * Use the caller's LV if it has one, so activating many LVs of a VG
+ * does not read and import the whole VG again for each of them.
+ * Replicator devices read and release their remote VGs during
+ * activation, so they keep using a private copy.
+ * *lv_to_free is set when the VG was read here and must be released.
+ */
+static struct logical_volume *_lv_for_activation(struct cmd_context *cmd,
+						 const char *lvid_s,
+						 struct logical_volume *lv,
+						 struct logical_volume **lv_to_free)
+{
+	*lv_to_free = NULL;
+
+	if (lv && !lv_is_replicator_dev(lv))
+		return lv;
+
+	return *lv_to_free = lv_from_lvid(cmd, lvid_s, 0);
+}
+
 int lv_info_by_lvid(struct cmd_context *cmd, const char *lvid_s, int use_layer,
 		    struct lvinfo *info, int with_open_count, int with_read_ahead)
 {
@@ -1140,12 +1272,68 @@ static char *_build_target_uuid(struct cmd_context *cmd, struct logical_volume *
 	return build_dm_uuid(cmd->mem, lv->lvid.s, layer);
 }
 
+/*
+ * Requests to dmeventd issued between monitor_batch_begin() and
+ * monitor_batch_end() share one connection to the daemon.
+ * Time spent talking to dmeventd is reported when the batch ends.
+ */
+static unsigned _monitor_batch_depth = 0;
+static unsigned _monitor_ipc_count = 0;
+static uint64_t _monitor_ipc_usecs = 0;
+
+static uint64_t _monitor_ipc_time(void)
+{
+	struct timeval tv;
+
+	if (gettimeofday(&tv, NULL))
+		return 0;
+
+	return (uint64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static void _monitor_ipc_done(uint64_t start)
+{
+	uint64_t end = _monitor_ipc_time();
+
+	_monitor_ipc_count++;
+	if (end > start)
+		_monitor_ipc_usecs += end - start;
+}
+
+void monitor_batch_begin(void)
+{
+	if (!_monitor_batch_depth++) {
+		_monitor_ipc_count = 0;
+		_monitor_ipc_usecs = 0;
+	}
+
+	dm_event_hold_connection();
+}
+
+void monitor_batch_end(void)
+{
+	dm_event_release_connection();
+
+	if (!_monitor_batch_depth) {
+		log_error(INTERNAL_ERROR "Unbalanced monitoring batch.");
+		return;
+	}
+
+	if (--_monitor_batch_depth || !_monitor_ipc_count)
+		return;
+
+	log_verbose("Spent %.3f seconds in %u dmeventd request(s).",
+		    (double) _monitor_ipc_usecs / 1000000, _monitor_ipc_count);
+}
+
 int target_registered_with_dmeventd(struct cmd_context *cmd, const char *dso,
 				    struct logical_volume *lv, int *pending)
 {
 	char *uuid;
 	enum dm_event_mask evmask = 0;
 	struct dm_event_handler *dmevh;
+	uint64_t start;
+	int r;
 	*pending = 0;
 
 	if (!dso)
@@ -1157,7 +1345,11 @@ int target_registered_with_dmeventd(struct cmd_context *cmd, const char *dso,
 	if (!(dmevh = _create_dm_event_handler(cmd, uuid, dso, 0, DM_EVENT_ALL_ERRORS)))
 		return_0;
 
-	if (dm_event_get_registered_device(dmevh, 0)) {
+	start = _monitor_ipc_time();
+	r = dm_event_get_registered_device(dmevh, 0);
+	_monitor_ipc_done(start);
+
+	if (r) {
 		dm_event_handler_destroy(dmevh);
 		return 0;
 	}
@@ -1178,6 +1370,7 @@ int target_register_events(struct cmd_context *cmd, const char *dso, struct logi
 {
 	char *uuid;
 	struct dm_event_handler *dmevh;
+	uint64_t start;
 	int r;
 
 	if (!dso)
@@ -1191,7 +1384,9 @@ int target_register_events(struct cmd_context *cmd, const char *dso, struct logi
 					       DM_EVENT_ALL_ERRORS | (timeout ? DM_EVENT_TIMEOUT : 0))))
 		return_0;
 
+	start = _monitor_ipc_time();
 	r = set ? dm_event_register_handler(dmevh) : dm_event_unregister_handler(dmevh);
+	_monitor_ipc_done(start);
 
 	dm_event_handler_destroy(dmevh);
 
@@ -1203,16 +1398,9 @@ int target_register_events(struct cmd_context *cmd, const char *dso, struct logi
 	return 1;
 }
 
-#endif
-
-/*
- * Returns 0 if an attempt to (un)monitor the device failed.
- * Returns 1 otherwise.
- */
-int monitor_dev_for_events(struct cmd_context *cmd, struct logical_volume *lv,
-			   const struct lv_activate_opts *laopts, int monitor)
+static int _monitor_dev_for_events(struct cmd_context *cmd, struct logical_volume *lv,
+				   const struct lv_activate_opts *laopts, int monitor)
 {
-#ifdef DMEVENTD
 	int i, pending = 0, monitored;
 	int r = 1;
 	struct dm_list *tmp, *snh, *snht;
@@ -1255,7 +1443,7 @@ int monitor_dev_for_events(struct cmd_context *cmd, struct logical_volume *lv,
 	 * not the actual LV itself.
 	 */
 	if (lv_is_cow(lv) && (laopts->no_merging || !lv_is_merging_cow(lv)))
-		return monitor_dev_for_events(cmd, lv->snapshot->lv, NULL, monitor);
+		return _monitor_dev_for_events(cmd, lv->snapshot->lv, NULL, monitor);
 
 	/*
 	 * In case this LV is a snapshot origin, we instead monitor
@@ -1264,7 +1452,7 @@ int monitor_dev_for_events(struct cmd_context *cmd, struct logical_volume *lv,
 	 */
 	if (!laopts->origin_only && lv_is_origin(lv))
 		dm_list_iterate_safe(snh, snht, &lv->snapshot_segs)
-			if (!monitor_dev_for_events(cmd, dm_list_struct_base(snh,
+			if (!_monitor_dev_for_events(cmd, dm_list_struct_base(snh,
 				    struct lv_segment, origin_list)->cow, NULL, monitor))
 				r = 0;
 
@@ -1275,7 +1463,7 @@ int monitor_dev_for_events(struct cmd_context *cmd, struct logical_volume *lv,
 	if ((seg = first_seg(lv)) != NULL && seg->log_lv != NULL &&
 	    (log_seg = first_seg(seg->log_lv)) != NULL &&
 	    seg_is_mirrored(log_seg))
-		if (!monitor_dev_for_events(cmd, seg->log_lv, NULL, monitor))
+		if (!_monitor_dev_for_events(cmd, seg->log_lv, NULL, monitor))
 			r = 0;
 
 	dm_list_iterate(tmp, &lv->segments) {
@@ -1285,7 +1473,7 @@ int monitor_dev_for_events(struct cmd_context *cmd, struct logical_volume *lv,
 		for (s = 0; s < seg->area_count; s++) {
 			if (seg_type(seg, s) != AREA_LV)
 				continue;
-			if (!monitor_dev_for_events(cmd, seg_lv(seg, s), NULL,
+			if (!_monitor_dev_for_events(cmd, seg_lv(seg, s), NULL,
 						    monitor)) {
 				log_error("Failed to %smonitor %s",
 					  monitor ? "" : "un",
@@ -1301,12 +1489,12 @@ int monitor_dev_for_events(struct cmd_context *cmd, struct logical_volume *lv,
 		 * FIXME: code here looks like _lv_postorder()
 		 */
 		if (seg->pool_lv &&
-		    !monitor_dev_for_events(cmd, seg->pool_lv,
+		    !_monitor_dev_for_events(cmd, seg->pool_lv,
 					    (!monitor) ? &thinopts : NULL, monitor))
 			r = 0;
 
 		if (seg->metadata_lv &&
-		    !monitor_dev_for_events(cmd, seg->metadata_lv, NULL, monitor))
+		    !_monitor_dev_for_events(cmd, seg->metadata_lv, NULL, monitor))
 			r = 0;
 
 		if (!seg_monitored(seg) || (seg->status & PVMOVE))
@@ -1374,6 +1562,33 @@ int monitor_dev_for_events(struct cmd_context *cmd, struct logical_volume *lv,
 			r = (monitored && monitor) || (!monitored && !monitor);
 	}
 
+	return r;
+}
+
+#else
+void monitor_batch_begin(void)
+{
+}
+
+void monitor_batch_end(void)
+{
+}
+#endif
+
+/*
+ * Returns 0 if an attempt to (un)monitor the device failed.
+ * Returns 1 otherwise.
+ */
+int monitor_dev_for_events(struct cmd_context *cmd, struct logical_volume *lv,
+			   const struct lv_activate_opts *laopts, int monitor)
+{
+#ifdef DMEVENTD
+	int r;
+
+	monitor_batch_begin();
+	r = _monitor_dev_for_events(cmd, lv, laopts, monitor);
+	monitor_batch_end();
+
 	return r;
 #else
 	return 1;
@@ -1695,16 +1910,17 @@ static int _lv_has_open_snapshots(struct logical_volume *lv)
 	return r;
 }
 
-int lv_deactivate(struct cmd_context *cmd, const char *lvid_s)
+int lv_deactivate(struct cmd_context *cmd, const char *lvid_s,
+		  struct logical_volume *lv)
 {
-	struct logical_volume *lv;
+	struct logical_volume *lv_to_free;
 	struct lvinfo info;
 	int r = 0;
 
 	if (!activation())
 		return 1;
 
-	if (!(lv = lv_from_lvid(cmd, lvid_s, 0)))
+	if (!(lv = _lv_for_activation(cmd, lvid_s, lv, &lv_to_free)))
 		goto out;
 
 	if (test_mode()) {
@@ -1746,9 +1962,9 @@ int lv_deactivate(struct cmd_context *cmd, const char *lvid_s)
 	if (!lv_info(cmd, lv, 0, &info, 0, 0) || info.exists)
 		r = 0;
 out:
-	if (lv) {
-		lv_release_replicator_vgs(lv);
-		release_vg(lv->vg);
+	if (lv_to_free) {
+		lv_release_replicator_vgs(lv_to_free);
+		release_vg(lv_to_free->vg);
 	}
 
 	return r;
@@ -1784,16 +2000,17 @@ out:
 }
 
 static int _lv_activate(struct cmd_context *cmd, const char *lvid_s,
-			struct lv_activate_opts *laopts, int filter)
+			struct lv_activate_opts *laopts, int filter,
+			struct logical_volume *lv)
 {
-	struct logical_volume *lv;
+	struct logical_volume *lv_to_free;
 	struct lvinfo info;
 	int r = 0;
 
 	if (!activation())
 		return 1;
 
-	if (!(lv = lv_from_lvid(cmd, lvid_s, 0)))
+	if (!(lv = _lv_for_activation(cmd, lvid_s, lv, &lv_to_free)))
 		goto out;
 
 	if (filter && !_passes_activation_filter(cmd, lv)) {
@@ -1853,9 +2070,9 @@ static int _lv_activate(struct cmd_context *cmd, const char *lvid_s,
 		stack;
 
 out:
-	if (lv) {
-		lv_release_replicator_vgs(lv);
-		release_vg(lv->vg);
+	if (lv_to_free) {
+		lv_release_replicator_vgs(lv_to_free);
+		release_vg(lv_to_free->vg);
 	}
 
 	return r;
@@ -1866,18 +2083,19 @@ int lv_activate(struct cmd_context *cmd, const char *lvid_s, int exclusive)
 {
 	struct lv_activate_opts laopts = { .exclusive = exclusive };
 
-	if (!_lv_activate(cmd, lvid_s, &laopts, 0))
+	if (!_lv_activate(cmd, lvid_s, &laopts, 0, NULL))
 		return_0;
 
 	return 1;
 }
 
 /* Activate LV only if it passes filter */
-int lv_activate_with_filter(struct cmd_context *cmd, const char *lvid_s, int exclusive)
+int lv_activate_with_filter(struct cmd_context *cmd, const char *lvid_s, int exclusive,
+			    struct logical_volume *lv)
 {
 	struct lv_activate_opts laopts = { .exclusive = exclusive };
 
-	if (!_lv_activate(cmd, lvid_s, &laopts, 1))
+	if (!_lv_activate(cmd, lvid_s, &laopts, 1, lv))
 		return_0;
 
 	return 1;
@@ -1921,11 +2139,15 @@ int pv_uses_vg(struct physical_volume *pv,
 
 void activation_release(void)
 {
+	_destroy_volume_list_filter(&_volume_list_filter);
+	_destroy_volume_list_filter(&_read_only_volume_list_filter);
 	dev_manager_release();
 }
 
 void activation_exit(void)
 {
+	_destroy_volume_list_filter(&_volume_list_filter);
+	_destroy_volume_list_filter(&_read_only_volume_list_filter);
 	dev_manager_exit();
 }
 #endif
@@ -71,9 +71,14 @@ int lv_resume(struct cmd_context *cmd, const char *lvid_s, unsigned origin_only)
 int lv_resume_if_active(struct cmd_context *cmd, const char *lvid_s,
 			unsigned origin_only, unsigned exclusive, unsigned revert);
 int lv_activate(struct cmd_context *cmd, const char *lvid_s, int exclusive);
+/*
+ * If lv is set it is the caller's in-memory copy of the LV with lvid_s
+ * and is used instead of reading its VG again.
+ */
 int lv_activate_with_filter(struct cmd_context *cmd, const char *lvid_s,
-			    int exclusive);
-int lv_deactivate(struct cmd_context *cmd, const char *lvid_s);
+			    int exclusive, struct logical_volume *lv);
+int lv_deactivate(struct cmd_context *cmd, const char *lvid_s,
+		  struct logical_volume *lv);
 
 int lv_mknodes(struct cmd_context *cmd, const struct logical_volume *lv);
 
@@ -126,6 +131,9 @@ int lv_has_target_type(struct dm_pool *mem, struct logical_volume *lv,
 
 int monitor_dev_for_events(struct cmd_context *cmd, struct logical_volume *lv,
 			   const struct lv_activate_opts *laopts, int do_reg);
+/* Share one dmeventd connection among monitoring requests in between. */
+void monitor_batch_begin(void);
+void monitor_batch_end(void);
 
 #ifdef DMEVENTD
 #  include "libdevmapper-event.h"
@@ -1385,6 +1385,21 @@ int lvmcache_add_orphan_vginfo(const char *vgname, struct format_type *fmt)
 	return _lvmcache_update_vgname(NULL, vgname, vgname, 0, "", fmt);
 }
 
+/*
+ * Make a VG known by name and ID only, without any PVs or metadata: lvmetad
+ * lists VGs this way and the metadata is looked up when the VG is read.
+ */
+int lvmcache_add_vginfo(const char *vgname, const char *vgid,
+			const struct format_type *fmt)
+{
+	if (!_lock_hash && !lvmcache_init()) {
+		log_error("Internal cache initialisation failed");
+		return 0;
+	}
+
+	return _lvmcache_update_vgname(NULL, vgname, vgid, 0, NULL, fmt);
+}
+
 int lvmcache_update_vgname_and_id(struct lvmcache_info *info,
 				  const char *vgname, const char *vgid,
 				  uint32_t vgstatus, const char *creation_host)
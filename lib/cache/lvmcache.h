@@ -53,6 +53,8 @@ struct lvmcache_info *lvmcache_add(struct labeller *labeller, const char *pvid,
 				   const char *vgname, const char *vgid,
 				   uint32_t vgstatus);
 int lvmcache_add_orphan_vginfo(const char *vgname, struct format_type *fmt);
+int lvmcache_add_vginfo(const char *vgname, const char *vgid,
+			const struct format_type *fmt);
 void lvmcache_del(struct lvmcache_info *info);
 
 /* Update things */
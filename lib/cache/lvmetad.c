@@ -28,6 +28,10 @@ static daemon_handle _lvmetad;
 void lvmetad_init(void)
 {
 	const char *socket = getenv("LVM_LVMETAD_SOCKET");
+
+	/* Generations are only meaningful to the lvmetad that gave them out. */
+	lvmetad_drop_prefetched_vgs();
+
 	if (_using_lvmetad) { /* configured by the toolcontext */
 		_lvmetad = lvmetad_open(socket ?: DEFAULT_RUN_DIR "/lvmetad.socket");
 		if (_lvmetad.socket_fd < 0 || _lvmetad.error) {
@@ -170,11 +174,17 @@ static struct lvmcache_info *_pv_populate_lvmcache(
 	return info;
 }
 
-struct volume_group *lvmetad_vg_lookup(struct cmd_context *cmd, const char *vgname, const char *vgid)
+/*
+ * Import a VG returned by lvmetad and poke it into lvmcache. The VG is
+ * described by the "name" and "metadata" nodes among the siblings starting at
+ * vgn: the root of a vg_lookup reply or a VG section of a vg_lookup_many reply.
+ */
+static struct volume_group *_import_vg(struct cmd_context *cmd,
+				       struct dm_config_node *vgn,
+				       const char *vgid)
 {
-	struct volume_group *vg = NULL;
-	daemon_reply reply;
-	char uuid[64];
+	struct volume_group *vg;
+	struct dm_config_tree vg_cft = { .root = NULL };
 	struct format_instance *fid;
 	struct format_instance_ctx fic;
 	struct dm_config_node *top;
@@ -185,63 +195,159 @@ struct volume_group *lvmetad_vg_lookup(struct cmd_context *cmd, const char *vgna
 	struct pv_list *pvl;
 	struct lvmcache_info *info;
 
-	if (!_using_lvmetad)
+	if (!(top = dm_config_find_node(vgn, "metadata")) ||
+	    !(name = dm_config_find_str(vgn, "name", NULL))) {
+		log_error(INTERNAL_ERROR "Incomplete VG metadata received from lvmetad.");
 		return NULL;
+	}
 
-	if (vgid) {
-		if (!id_write_format((const struct id*)vgid, uuid, sizeof(uuid)))
-			return_0;
-		reply = daemon_send_simple(_lvmetad, "vg_lookup", "uuid = %s", uuid, NULL);
-	} else {
-		if (!vgname)
-			log_error(INTERNAL_ERROR "VG name required (VGID not available)");
-		reply = daemon_send_simple(_lvmetad, "vg_lookup", "name = %s", vgname, NULL);
+	/* fall back to lvm2 if we don't know better */
+	fmt_name = dm_config_find_str(top, "metadata/format", "lvm2");
+	if (!(fmt = get_format_by_name(cmd, fmt_name))) {
+		log_error(INTERNAL_ERROR
+			  "We do not know the format (%s) reported by lvmetad.",
+			  fmt_name);
+		return NULL;
 	}
 
-	if (!strcmp(daemon_reply_str(reply, "response", ""), "OK")) {
+	fic.type = FMT_INSTANCE_MDAS | FMT_INSTANCE_AUX_MDAS;
+	fic.context.vg_ref.vg_name = name;
+	fic.context.vg_ref.vg_id = vgid;
 
-		top = dm_config_find_node(reply.cft->root, "metadata");
-		name = daemon_reply_str(reply, "name", NULL);
+	if (!(fid = fmt->ops->create_instance(fmt, &fic)))
+		return_NULL;
 
-		/* fall back to lvm2 if we don't know better */
-		fmt_name = dm_config_find_str(top, "metadata/format", "lvm2");
-		if (!(fmt = get_format_by_name(cmd, fmt_name))) {
-			log_error(INTERNAL_ERROR
-				  "We do not know the format (%s) reported by lvmetad.",
-				  fmt_name);
-			goto out;
-		}
+	if ((pvcn = dm_config_find_node(top, "metadata/physical_volumes")))
+		for (pvcn = pvcn->child; pvcn; pvcn = pvcn->sib)
+			_pv_populate_lvmcache(cmd, pvcn, 0);
 
-		fic.type = FMT_INSTANCE_MDAS | FMT_INSTANCE_AUX_MDAS;
-		fic.context.vg_ref.vg_name = name;
-		fic.context.vg_ref.vg_id = vgid;
-
-		if (!(fid = fmt->ops->create_instance(fmt, &fic)))
-			goto_out;
-
-		if ((pvcn = dm_config_find_node(top, "metadata/physical_volumes")))
-			for (pvcn = pvcn->child; pvcn; pvcn = pvcn->sib)
-				_pv_populate_lvmcache(cmd, pvcn, 0);
-
-		top->key = name;
-		if (!(vg = import_vg_from_config_tree(reply.cft, fid)))
-			goto_out;
-
-		dm_list_iterate_items(pvl, &vg->pvs) {
-			if ((info = lvmcache_info_from_pvid((const char *)&pvl->pv->id, 0))) {
-				pvl->pv->label_sector = lvmcache_get_label(info)->sector;
-				pvl->pv->dev = lvmcache_device(info);
-				if (!lvmcache_fid_add_mdas_pv(info, fid)) {
-					vg = NULL;
-					goto_out;	/* FIXME error path */
-				}
-			} /* else probably missing */
-		}
+	/*
+	 * The text importer looks for the VG section among the root's siblings.
+	 * A prefetched VG may be imported again, so restore the key after.
+	 */
+	top->key = name;
+	vg_cft.root = vgn;
+	vg = import_vg_from_config_tree(&vg_cft, fid);
+	top->key = "metadata";
+	if (!vg)
+		return_NULL;
 
-		lvmcache_update_vg(vg, 0);
+	dm_list_iterate_items(pvl, &vg->pvs) {
+		if ((info = lvmcache_info_from_pvid((const char *)&pvl->pv->id, 0))) {
+			pvl->pv->label_sector = lvmcache_get_label(info)->sector;
+			pvl->pv->dev = lvmcache_device(info);
+			if (!lvmcache_fid_add_mdas_pv(info, fid))
+				return_NULL;	/* FIXME error path */
+		} /* else probably missing */
 	}
 
-out:
+	lvmcache_update_vg(vg, 0);
+
+	return vg;
+}
+
+/*
+ * VGs fetched ahead with vg_lookup_many when the VGs are listed, by VG UUID
+ * and by name. vg_read may only use one after it took the VG lock and vg_check
+ * confirmed the VG is still at the generation fetched; otherwise it does a full
+ * vg_lookup. The replies they point into are kept until the command ends.
+ */
+static struct dm_hash_table *_prefetched_by_vgid = NULL;
+static struct dm_hash_table *_prefetched_by_name = NULL;
+static daemon_reply *_prefetch_replies = NULL;
+static unsigned _prefetch_reply_count = 0;
+
+void lvmetad_drop_prefetched_vgs(void)
+{
+	unsigned i;
+
+	if (_prefetched_by_vgid) {
+		dm_hash_destroy(_prefetched_by_vgid);
+		_prefetched_by_vgid = NULL;
+	}
+
+	if (_prefetched_by_name) {
+		dm_hash_destroy(_prefetched_by_name);
+		_prefetched_by_name = NULL;
+	}
+
+	for (i = 0; i < _prefetch_reply_count; i++)
+		daemon_reply_destroy(_prefetch_replies[i]);
+
+	dm_free(_prefetch_replies);
+	_prefetch_replies = NULL;
+	_prefetch_reply_count = 0;
+}
+
+/* Find the prefetched VG section, checking with lvmetad that it is current. */
+static struct dm_config_node *_prefetched_vg(const char *uuid, const char *vgname)
+{
+	struct dm_config_node *cn = NULL;
+	const char *name;
+	char generation[64];
+	daemon_reply reply;
+	int current;
+
+	if (uuid && _prefetched_by_vgid)
+		cn = dm_hash_lookup(_prefetched_by_vgid, uuid);
+	else if (vgname && _prefetched_by_name)
+		cn = dm_hash_lookup(_prefetched_by_name, vgname);
+
+	if (!cn)
+		return NULL;
+
+	if (dm_snprintf(generation, sizeof(generation), "generation = %" PRId64 "\n",
+			dm_config_find_int64(cn->child, "generation", -1)) < 0)
+		return_NULL;
+
+	reply = daemon_send_simple(_lvmetad, "vg_check", "uuid = %s", cn->key,
+				   generation, NULL);
+
+	/* An lvmetad without vg_check answers "failed": do the full lookup. */
+	current = !reply.error && reply.cft &&
+		  !strcmp(daemon_reply_str(reply, "response", ""), "OK");
+	daemon_reply_destroy(reply);
+
+	if (current) {
+		log_debug("Using VG %s prefetched from lvmetad.", cn->key);
+		return cn->child;
+	}
+
+	/* Never worth checking again. */
+	dm_hash_remove(_prefetched_by_vgid, cn->key);
+	if ((name = dm_config_find_str(cn->child, "name", NULL)))
+		dm_hash_remove(_prefetched_by_name, name);
+
+	return NULL;
+}
+
+struct volume_group *lvmetad_vg_lookup(struct cmd_context *cmd, const char *vgname, const char *vgid)
+{
+	struct volume_group *vg = NULL;
+	struct dm_config_node *vgn;
+	daemon_reply reply;
+	char uuid[64];
+
+	if (!_using_lvmetad)
+		return NULL;
+
+	if (vgid && !id_write_format((const struct id*)vgid, uuid, sizeof(uuid)))
+		return_0;
+
+	if ((vgn = _prefetched_vg(vgid ? uuid : NULL, vgname)))
+		return _import_vg(cmd, vgn, vgid);
+
+	if (vgid)
+		reply = daemon_send_simple(_lvmetad, "vg_lookup", "uuid = %s", uuid, NULL);
+	else {
+		if (!vgname)
+			log_error(INTERNAL_ERROR "VG name required (VGID not available)");
+		reply = daemon_send_simple(_lvmetad, "vg_lookup", "name = %s", vgname, NULL);
+	}
+
+	if (!strcmp(daemon_reply_str(reply, "response", ""), "OK"))
+		vg = _import_vg(cmd, reply.cft->root, vgid);
+
 	daemon_reply_destroy(reply);
 
 	return vg;
@@ -438,17 +544,117 @@ int lvmetad_pv_list_to_lvmcache(struct cmd_context *cmd)
 	return 1;
 }
 
+/* VGs asked for by one vg_lookup_many, and how many of those may be in flight. */
+#define PREFETCH_BATCH 32
+#define PREFETCH_WINDOW 4
+
+/* Send vg_lookup_many for the next batch of listed VGs, moving *next past it. */
+static int _send_lookup_many(struct dm_config_node **next)
+{
+	struct dm_config_node *cn;
+	char *uuids, *p;
+	size_t len = sizeof("uuids = [ ]\n");
+	unsigned i;
+	int r;
+
+	for (cn = *next, i = 0; cn && i < PREFETCH_BATCH; cn = cn->sib, i++)
+		len += strlen(cn->key) + 4;
+
+	if (!(p = uuids = dm_malloc(len)))
+		return_0;
+
+	p += sprintf(p, "uuids = [");
+	for (i = 0; *next && i < PREFETCH_BATCH; *next = (*next)->sib, i++)
+		p += sprintf(p, "%s\"%s\"", i ? ", " : " ", (*next)->key);
+	sprintf(p, " ]\n");
+
+	r = daemon_write_simple(_lvmetad, "vg_lookup_many", uuids, NULL);
+	dm_free(uuids);
+
+	return r;
+}
+
+/*
+ * Fetch all the listed VGs ahead of vg_read, PREFETCH_BATCH to a request with
+ * up to PREFETCH_WINDOW requests written before their replies are read. The
+ * first one goes alone: an lvmetad without vg_lookup_many does not read
+ * pipelined requests either, and vg_read then looks up each VG on its own.
+ */
+static void _prefetch_vgs(struct dm_config_node *vgs)
+{
+	struct dm_config_node *cn, *next = vgs;
+	daemon_reply *reply;
+	const char *name;
+	unsigned count = 0, sent = 0;
+
+	for (cn = vgs; cn; cn = cn->sib)
+		count++;
+
+	if (!count)
+		return;
+
+	if (!(_prefetch_replies = dm_zalloc(sizeof(*_prefetch_replies) *
+					    ((count + PREFETCH_BATCH - 1) / PREFETCH_BATCH))) ||
+	    !(_prefetched_by_vgid = dm_hash_create(count)) ||
+	    !(_prefetched_by_name = dm_hash_create(count))) {
+		log_error("Failed to allocate VG prefetch from lvmetad.");
+		lvmetad_drop_prefetched_vgs();
+		return;
+	}
+
+	while (next || sent > _prefetch_reply_count) {
+		while (next && sent < _prefetch_reply_count +
+		       (_prefetch_reply_count ? PREFETCH_WINDOW : 1)) {
+			if (!_send_lookup_many(&next)) {
+				log_error("Request to look up VGs in lvmetad gave response %s.",
+					  strerror(errno));
+				next = NULL;
+				break;
+			}
+			sent++;
+		}
+
+		if (sent == _prefetch_reply_count)
+			break;
+
+		reply = &_prefetch_replies[_prefetch_reply_count++];
+		*reply = daemon_read_reply(_lvmetad);
+
+		if (reply->error || !reply->cft) {
+			log_error("Request to look up VGs in lvmetad gave response %s.",
+				  strerror(reply->error ? : EINVAL));
+			break;
+		}
+
+		if (strcmp(daemon_reply_str(*reply, "response", ""), "OK")) {
+			log_debug("lvmetad did not prefetch VGs: %s",
+				  daemon_reply_str(*reply, "reason", "<missing>"));
+			next = NULL;
+			continue;
+		}
+
+		if ((cn = dm_config_find_node(reply->cft->root, "volume_groups")))
+			for (cn = cn->child; cn; cn = cn->sib)
+				if (!dm_hash_insert(_prefetched_by_vgid, cn->key, cn) ||
+				    ((name = dm_config_find_str(cn->child, "name", NULL)) &&
+				     !dm_hash_insert(_prefetched_by_name, name, cn)))
+					stack;
+	}
+}
+
 int lvmetad_vg_list_to_lvmcache(struct cmd_context *cmd)
 {
-	struct volume_group *tmp;
+	struct format_type *fmt;
 	struct id vgid;
-	const char *vgid_txt;
+	const char *vgid_txt, *name;
 	daemon_reply reply;
 	struct dm_config_node *cn;
 
 	if (!_using_lvmetad)
 		return 1;
 
+	lvmetad_drop_prefetched_vgs();
+
 	reply = daemon_send_simple(_lvmetad, "vg_list", NULL);
 
 	if (!_lvmetad_handle_reply(reply, "list VGs", "", NULL)) {
@@ -456,19 +662,29 @@ int lvmetad_vg_list_to_lvmcache(struct cmd_context *cmd)
 		return_0;
 	}
 
+	/* The list only carries names; the metadata is prefetched for vg_read. */
+	if (!(fmt = get_format_by_name(cmd, "lvm2"))) {
+		log_error(INTERNAL_ERROR "lvm2 format not found.");
+		daemon_reply_destroy(reply);
+		return 0;
+	}
+
 	if ((cn = dm_config_find_node(reply.cft->root, "volume_groups")))
 		for (cn = cn->child; cn; cn = cn->sib) {
 			vgid_txt = cn->key;
-			if (!id_read_format(&vgid, vgid_txt)) {
+			if (!id_read_format(&vgid, vgid_txt) ||
+			    !(name = dm_config_find_str(cn->child, "name", NULL))) {
 				stack;
 				continue;
 			}
 
-			/* the call to lvmetad_vg_lookup will poke the VG into lvmcache */
-			tmp = lvmetad_vg_lookup(cmd, NULL, (const char*)&vgid);
-			release_vg(tmp);
+			if (!lvmcache_add_vginfo(name, (const char *)&vgid, fmt))
+				stack;
 		}
 
+	if ((cn = dm_config_find_node(reply.cft->root, "volume_groups")))
+		_prefetch_vgs(cn->child);
+
 	daemon_reply_destroy(reply);
 	return 1;
 }
@@ -535,25 +751,16 @@ static const char *_print_mdas(struct lvmcache_info *info)
 	return baton.buffer;
 }
 
-int lvmetad_pv_found(struct id pvid, struct device *device, const struct format_type *fmt,
-		     uint64_t label_sector, struct volume_group *vg)
+/* The "pvmeta" section describing a PV to lvmetad, including its MDAs. */
+static char *_print_pvmeta(const char *uuid, struct device *device,
+			   const struct format_type *fmt, uint64_t label_sector,
+			   struct lvmcache_info *info)
 {
-	char uuid[64];
-	daemon_reply reply;
-	struct lvmcache_info *info;
 	const char *mdas = NULL;
 	char *pvmeta;
-	char *buf = NULL;
-	int result;
-
-	if (!_using_lvmetad)
-		return 1;
-
-	if (!id_write_format(&pvid, uuid, sizeof(uuid)))
-                return_0;
 
 	/* FIXME A more direct route would be much preferable. */
-	if ((info = lvmcache_info_from_pvid((const char *)&pvid, 0)))
+	if (info)
 		mdas = _print_mdas(info);
 
 	if (!dm_asprintf(&pvmeta,
@@ -565,13 +772,33 @@ int lvmetad_pv_found(struct id pvid, struct device *device, const struct format_
 			 "  %s"
 			 "}", device->dev,
 			 info ? lvmcache_device_size(info) : 0,
-			 fmt->name, label_sector, uuid, mdas ?: "")) {
-		dm_free((char *)mdas);
-		return_0;
-	}
+			 fmt->name, label_sector, uuid, mdas ?: ""))
+		pvmeta = NULL;
 
 	dm_free((char *)mdas);
 
+	return pvmeta;
+}
+
+int lvmetad_pv_found(struct id pvid, struct device *device, const struct format_type *fmt,
+		     uint64_t label_sector, struct volume_group *vg)
+{
+	char uuid[64];
+	daemon_reply reply;
+	char *pvmeta;
+	char *buf = NULL;
+	int result;
+
+	if (!_using_lvmetad)
+		return 1;
+
+	if (!id_write_format(&pvid, uuid, sizeof(uuid)))
+                return_0;
+
+	if (!(pvmeta = _print_pvmeta(uuid, device, fmt, label_sector,
+				     lvmcache_info_from_pvid((const char *)&pvid, 0))))
+		return_0;
+
 	if (vg) {
 		/*
 		 * TODO. This is not entirely correct, since export_vg_to_buffer
@@ -665,6 +892,43 @@ static int _pvscan_lvmetad_single(struct metadata_area *mda, void *baton)
 	return 1;
 }
 
+/*
+ * Ask lvmetad whether the PV, as just found by the label scan, is exactly
+ * what it already has: same pvmeta and the same metadata location and
+ * checksum in every MDA. Returns 1 only if so, in which case the metadata
+ * need not be read, exported and sent again.
+ */
+static int _pv_unchanged(struct device *dev, struct label *label)
+{
+	struct lvmcache_info *info = (struct lvmcache_info *) label->info;
+	char uuid[64];
+	daemon_reply reply;
+	char *pvmeta;
+	int result;
+
+	/* Only PVs with VG metadata have anything worth skipping. */
+	if (lvmcache_is_orphan(info))
+		return 0;
+
+	if (!id_write_format((const struct id *)dev->pvid, uuid, sizeof(uuid)) ||
+	    !(pvmeta = _print_pvmeta(uuid, dev, lvmcache_fmt(info), label->sector, info)))
+		return_0;
+
+	reply = daemon_send_simple(_lvmetad, "pv_check", "pvmeta = %b", pvmeta, NULL);
+	dm_free(pvmeta);
+
+	/* An lvmetad without pv_check answers "failed": do the full update. */
+	result = !reply.error && reply.cft &&
+		 !strcmp(daemon_reply_str(reply, "response", ""), "OK");
+	daemon_reply_destroy(reply);
+
+	if (result)
+		log_debug("Metadata on %s unchanged since last sent to lvmetad.",
+			  dev_name(dev));
+
+	return result;
+}
+
 int pvscan_lvmetad_single(struct cmd_context *cmd, struct device *dev)
 {
 	struct label *label;
@@ -686,6 +950,9 @@ int pvscan_lvmetad_single(struct cmd_context *cmd, struct device *dev)
 		return 1;
 	}
 
+	if (_pv_unchanged(dev, label))
+		return 1;
+
 	info = (struct lvmcache_info *) label->info;
 	memset(&pv, 0, sizeof(pv));
 
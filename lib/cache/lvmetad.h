@@ -92,6 +92,12 @@ int lvmetad_pv_lookup_by_dev(struct cmd_context *cmd, struct device *dev, int *f
  */
 int lvmetad_vg_list_to_lvmcache(struct cmd_context *cmd);
 
+/*
+ * Forget the VGs lvmetad_vg_list_to_lvmcache fetched ahead for vg_read. Called
+ * when a command ends.
+ */
+void lvmetad_drop_prefetched_vgs(void);
+
 /*
  * Find a VG by its ID or its name in the lvmetad cache. Gives NULL if the VG is
  * not found.
@@ -118,6 +124,7 @@ int pvscan_lvmetad_single(struct cmd_context *cmd, struct device *dev);
 #    define lvmetad_pv_lookup(cmd, pvid, found)	(0)
 #    define lvmetad_pv_lookup_by_dev(cmd, dev, found)	(0)
 #    define lvmetad_vg_list_to_lvmcache(cmd)	(1)
+#    define lvmetad_drop_prefetched_vgs()	do { } while (0)
 #    define lvmetad_vg_lookup(cmd, vgname, vgid)	(NULL)
 #    define pvscan_lvmetad_single(cmd, dev)	(0)
 
@@ -52,6 +52,7 @@
 
 #include <locale.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
 #include <sys/utsname.h>
 #include <syslog.h>
 #include <time.h>
@@ -653,11 +654,32 @@ static int _init_dev_cache(struct cmd_context *cmd)
 	size_t len, udev_dir_len = strlen(DM_UDEV_DEV_DIR);
 	int len_diff;
 	int device_list_from_udev;
+	int fd_cache_size;
+	int pv_init_parallelism;
+	struct rlimit rlim;
 
 	init_dev_disable_after_error_count(
 		find_config_tree_int(cmd, "devices/disable_after_error_count",
 				     DEFAULT_DISABLE_AFTER_ERROR_COUNT));
 
+	fd_cache_size = find_config_tree_int(cmd, "devices/open_fd_cache_size",
+					     DEFAULT_OPEN_FD_CACHE_SIZE);
+	if (fd_cache_size < 0)
+		fd_cache_size = 0;
+	/* Leave at least half of the descriptor limit for everything else */
+	if (!getrlimit(RLIMIT_NOFILE, &rlim) && rlim.rlim_cur != RLIM_INFINITY &&
+	    (rlim_t) fd_cache_size > rlim.rlim_cur / 2) {
+		log_verbose("Limiting devices/open_fd_cache_size to %u.",
+			    (unsigned) (rlim.rlim_cur / 2));
+		fd_cache_size = (int) (rlim.rlim_cur / 2);
+	}
+	cmd->open_fd_cache_size = (unsigned) fd_cache_size;
+
+	pv_init_parallelism = find_config_tree_int(cmd, "devices/pv_init_parallelism",
+						   DEFAULT_PV_INIT_PARALLELISM);
+	cmd->pv_init_parallelism = pv_init_parallelism > 1 ?
+		(unsigned) pv_init_parallelism : 1;
+
 	if (!dev_cache_init(cmd))
 		return_0;
 
@@ -732,7 +754,8 @@ static int _init_dev_cache(struct cmd_context *cmd)
 
 #define MAX_FILTERS 5
 
-static struct dev_filter *_init_filter_components(struct cmd_context *cmd)
+static struct dev_filter *_init_filter_components(struct cmd_context *cmd,
+						  const char *regex_cache)
 {
 	int nr_filt = 0;
 	const struct dm_config_node *cn;
@@ -763,7 +786,7 @@ static struct dev_filter *_init_filter_components(struct cmd_context *cmd)
 		log_very_verbose("devices/filter not found in config file: "
 				 "no regex filter installed");
 
-	else if (!(filters[nr_filt] = regex_filter_create(cn->v))) {
+	else if (!(filters[nr_filt] = regex_filter_create(cn->v, regex_cache))) {
 		log_error("Failed to create regex device filter");
 		goto bad;
 	} else
@@ -810,18 +833,14 @@ bad:
 static int _init_filters(struct cmd_context *cmd, unsigned load_persistent_cache)
 {
 	static char cache_file[PATH_MAX];
+	char regex_cache[PATH_MAX];
 	const char *dev_cache = NULL, *cache_dir, *cache_file_prefix;
 	struct dev_filter *f3, *f4;
 	struct stat st;
+	int write_cache_state;
 
 	cmd->dump_filter = 0;
 
-	if (!(f3 = _init_filter_components(cmd)))
-		return_0;
-
-	init_ignore_suspended_devices(find_config_tree_int(cmd,
-	    "devices/ignore_suspended_devices", DEFAULT_IGNORE_SUSPENDED_DEVICES));
-
 	/*
 	 * If 'cache_dir' or 'cache_file_prefix' is set, ignore 'cache'.
 	 */
@@ -836,7 +855,6 @@ static int _init_filters(struct cmd_context *cmd, unsigned load_persistent_cache
 		    cache_dir ? : DEFAULT_CACHE_SUBDIR,
 		    cache_file_prefix ? : DEFAULT_CACHE_FILE_PREFIX) < 0) {
 			log_error("Persistent cache filename too long.");
-			f3->destroy(f3);
 			return 0;
 		}
 	} else if (!(dev_cache = find_config_tree_str(cmd, "devices/cache", NULL)) &&
@@ -845,13 +863,28 @@ static int _init_filters(struct cmd_context *cmd, unsigned load_persistent_cache
 				cmd->system_dir, DEFAULT_CACHE_SUBDIR,
 				DEFAULT_CACHE_FILE_PREFIX) < 0)) {
 		log_error("Persistent cache filename too long.");
-		f3->destroy(f3);
 		return 0;
 	}
 
 	if (!dev_cache)
 		dev_cache = cache_file;
 
+	write_cache_state = find_config_tree_int(cmd, "devices/write_cache_state", 1) &&
+			    *cmd->system_dir;
+
+	/* The compiled regex filter is kept alongside the device cache. */
+	if (write_cache_state &&
+	    dm_snprintf(regex_cache, sizeof(regex_cache), "%s.regex", dev_cache) < 0) {
+		log_error("Regex filter cache filename too long.");
+		return 0;
+	}
+
+	if (!(f3 = _init_filter_components(cmd, write_cache_state ? regex_cache : NULL)))
+		return_0;
+
+	init_ignore_suspended_devices(find_config_tree_int(cmd,
+	    "devices/ignore_suspended_devices", DEFAULT_IGNORE_SUSPENDED_DEVICES));
+
 	if (!(f4 = persistent_filter_create(f3, dev_cache))) {
 		log_verbose("Failed to create persistent device filter.");
 		f3->destroy(f3);
@@ -859,12 +892,9 @@ static int _init_filters(struct cmd_context *cmd, unsigned load_persistent_cache
 	}
 
 	/* Should we ever dump persistent filter state? */
-	if (find_config_tree_int(cmd, "devices/write_cache_state", 1))
+	if (write_cache_state)
 		cmd->dump_filter = 1;
 
-	if (!*cmd->system_dir)
-		cmd->dump_filter = 0;
-
 	/*
 	 * Only load persistent filter device cache on startup if it is newer
 	 * than the config file and this is not a long-lived process.
@@ -1036,50 +1066,22 @@ static int _init_single_segtype(struct cmd_context *cmd,
 	return lvm_register_segtype(seglib, segtype);
 }
 
-static int _init_segtypes(struct cmd_context *cmd)
+/*
+ * Register the segment types from global/segment_libraries.
+ * Called when a segment type name is first not found.
+ */
+int load_segtype_libraries(struct cmd_context *cmd)
 {
-	int i;
+#ifdef HAVE_LIBDL
 	struct segment_type *segtype;
 	struct segtype_library seglib = { .cmd = cmd, .lib = NULL };
-	struct segment_type *(*init_segtype_array[])(struct cmd_context *cmd) = {
-		init_striped_segtype,
-		init_zero_segtype,
-		init_error_segtype,
-		init_free_segtype,
-#ifdef SNAPSHOT_INTERNAL
-		init_snapshot_segtype,
-#endif
-#ifdef MIRRORED_INTERNAL
-		init_mirrored_segtype,
-#endif
-		NULL
-	};
-
-#ifdef HAVE_LIBDL
 	const struct dm_config_node *cn;
 #endif
 
-	for (i = 0; init_segtype_array[i]; i++) {
-		if (!(segtype = init_segtype_array[i](cmd)))
-			return 0;
-		segtype->library = NULL;
-		dm_list_add(&cmd->segtypes, &segtype->list);
-	}
-
-#ifdef REPLICATOR_INTERNAL
-	if (!init_replicator_segtype(cmd, &seglib))
-		return 0;
-#endif
-
-#ifdef RAID_INTERNAL
-	if (!init_raid_segtypes(cmd, &seglib))
-		return 0;
-#endif
+	if (!cmd->segtype_libraries_pending)
+		return 1;
 
-#ifdef THIN_INTERNAL
-	if (!init_thin_segtypes(cmd, &seglib))
-		return 0;
-#endif
+	cmd->segtype_libraries_pending = 0;
 
 #ifdef HAVE_LIBDL
 	/* Load any formats in shared libs unless static */
@@ -1135,6 +1137,53 @@ static int _init_segtypes(struct cmd_context *cmd)
 	return 1;
 }
 
+static int _init_segtypes(struct cmd_context *cmd)
+{
+	int i;
+	struct segment_type *segtype;
+	struct segtype_library seglib = { .cmd = cmd, .lib = NULL };
+	struct segment_type *(*init_segtype_array[])(struct cmd_context *cmd) = {
+		init_striped_segtype,
+		init_zero_segtype,
+		init_error_segtype,
+		init_free_segtype,
+#ifdef SNAPSHOT_INTERNAL
+		init_snapshot_segtype,
+#endif
+#ifdef MIRRORED_INTERNAL
+		init_mirrored_segtype,
+#endif
+		NULL
+	};
+
+	for (i = 0; init_segtype_array[i]; i++) {
+		if (!(segtype = init_segtype_array[i](cmd)))
+			return 0;
+		segtype->library = NULL;
+		dm_list_add(&cmd->segtypes, &segtype->list);
+	}
+
+#ifdef REPLICATOR_INTERNAL
+	if (!init_replicator_segtype(cmd, &seglib))
+		return 0;
+#endif
+
+#ifdef RAID_INTERNAL
+	if (!init_raid_segtypes(cmd, &seglib))
+		return 0;
+#endif
+
+#ifdef THIN_INTERNAL
+	if (!init_thin_segtypes(cmd, &seglib))
+		return 0;
+#endif
+
+	/* Shared libraries are only loaded once a segtype is not found */
+	cmd->segtype_libraries_pending = 1;
+
+	return 1;
+}
+
 static int _init_hostname(struct cmd_context *cmd)
 {
 	struct utsname uts;
@@ -1549,6 +1598,7 @@ void destroy_toolcontext(struct cmd_context *cmd)
 	_destroy_formats(cmd, &cmd->formats);
 	if (cmd->filter)
 		cmd->filter->destroy(cmd->filter);
+	regex_filter_release_cache();
 	if (cmd->mem)
 		dm_pool_destroy(cmd->mem);
 	dev_cache_exit();
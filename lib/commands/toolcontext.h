@@ -88,9 +88,12 @@ struct cmd_context {
 	unsigned threaded:1;		/* Set if running within a thread e.g. clvmd */
 
 	unsigned independent_metadata_areas:1;	/* Active formats have MDAs outside PVs */
+	unsigned segtype_libraries_pending:1;	/* segment_libraries not loaded yet */
 
 	struct dev_filter *filter;
 	int dump_filter;	/* Dump filter when exiting? */
+	unsigned open_fd_cache_size;	/* Used by lvm_run_command only */
+	unsigned pv_init_parallelism;	/* Used by lvm_run_command only */
 
 	struct dm_list config_files;
 	int config_valid;
@@ -125,6 +128,7 @@ int refresh_toolcontext(struct cmd_context *cmd);
 int refresh_filters(struct cmd_context *cmd);
 int config_files_changed(struct cmd_context *cmd);
 int init_lvmcache_orphans(struct cmd_context *cmd);
+int load_segtype_libraries(struct cmd_context *cmd);
 
 struct format_type *get_format_by_name(struct cmd_context *cmd, const char *format);
 
@@ -195,6 +195,7 @@ int config_file_read_fd(struct dm_config_tree *cft, struct device *dev,
 	int r = 0;
 	int use_mmap = 1;
 	off_t mmap_offset = 0;
+	off_t align_offset;
 	char *buf = NULL;
 
 	/* Only use mmap with regular files */
@@ -212,15 +213,23 @@ int config_file_read_fd(struct dm_config_tree *cft, struct device *dev,
 		}
 		fb = fb + mmap_offset;
 	} else {
-		if (!(buf = dm_malloc(size + size2))) {
+		/*
+		 * Place the text at the same offset within a page as it
+		 * has on the device, so the device layer can read most
+		 * of it straight into place instead of via a bounce buffer.
+		 * If the text wraps, favour the larger of the two parts.
+		 */
+		if (!(buf = dm_malloc(size + size2 + lvm_getpagesize()))) {
 			log_error("Failed to allocate circular buffer.");
 			return 0;
 		}
+		align_offset = (size2 > size) ? offset2 - (off_t) size : offset;
+		fb = buf + (((uintptr_t) align_offset - (uintptr_t) buf) &
+			    (lvm_getpagesize() - 1));
 		if (!dev_read_circular(dev, (uint64_t) offset, size,
-				       (uint64_t) offset2, size2, buf)) {
+				       (uint64_t) offset2, size2, fb)) {
 			goto out;
 		}
-		fb = buf;
 	}
 
 	if (checksum_fn && checksum !=
@@ -64,6 +64,7 @@ static void _dev_init(struct device *dev, int max_error_count)
 
 	dm_list_init(&dev->aliases);
 	dm_list_init(&dev->open_list);
+	dm_list_init(&dev->fd_cache_list);
 }
 
 struct device *dev_create_file(const char *filename, struct device *dev,
@@ -773,8 +774,10 @@ static void _check_for_open_devices(void)
 
 void dev_cache_exit(void)
 {
-	if (_cache.names)
+	if (_cache.names) {
+		dev_close_cached();
 		_check_for_open_devices();
+	}
 
 	if (_cache.preferred_names_matcher)
 		_cache.preferred_names_matcher = NULL;
@@ -20,6 +20,7 @@
 #include "lvmcache.h"
 #include "memlock.h"
 #include "locking.h"
+#include "filter.h"
 
 #include <limits.h>
 #include <sys/stat.h>
@@ -39,6 +40,9 @@
 #  ifndef BLKDISCARD
 #    define BLKDISCARD	_IO(0x12,119)
 #  endif
+#  ifndef BLKZEROOUT
+#    define BLKZEROOUT	_IO(0x12,127)
+#  endif
 #else
 #  include <sys/disk.h>
 #  define BLKBSZGET DKIOCGETBLOCKSIZE
@@ -56,6 +60,17 @@
 
 static DM_LIST_INIT(_open_devices);
 
+/*
+ * Devices nobody references any more but which are kept open so the
+ * next dev_open of the same device can skip open(2).  Least recently
+ * used first.
+ */
+static DM_LIST_INIT(_fd_cache);
+static unsigned _fd_cache_count;
+static unsigned _fd_cache_opens;
+static unsigned _fd_cache_reused;
+static unsigned _fd_cache_evicted;
+
 /*-----------------------------------------------------------------
  * The standard io loop that keeps submitting an io until it's
  * all gone.
@@ -164,6 +179,62 @@ static void _widen_region(unsigned int block_size, struct device_area *region,
 		result->size += block_size - delta;
 }
 
+/*
+ * Read a region spanning at least one whole block into a buffer that
+ * has the same alignment as the region's offset on the device.  Only
+ * the partial first and last blocks go through a bounce buffer; the
+ * rest is read straight into place.
+ */
+static int _aligned_read_in_place(struct device_area *where, char *buffer,
+				  unsigned int block_size)
+{
+	uint64_t mask = block_size - 1;
+	uint64_t start = where->start, end = where->start + where->size;
+	uint64_t inner_start = (start + mask) & ~mask;
+	uint64_t inner_end = end & ~mask;
+	struct device_area area;
+	char *bounce, *bounce_buf;
+	int r = 0;
+
+	if (!(bounce_buf = bounce = dm_malloc((size_t) block_size * 2))) {
+		log_error("Bounce buffer malloc failed");
+		return 0;
+	}
+
+	if (((uintptr_t) bounce) & mask)
+		bounce = (char *) ((((uintptr_t) bounce) + mask) & ~mask);
+
+	area.dev = where->dev;
+	area.size = block_size;
+
+	if (start < inner_start) {
+		area.start = inner_start - block_size;
+		if (!_io(&area, bounce, 0))
+			goto_out;
+		memcpy(buffer, bounce + (start - area.start),
+		       (size_t) (inner_start - start));
+	}
+
+	area.start = inner_start;
+	area.size = inner_end - inner_start;
+	if (!_io(&area, buffer + (inner_start - start), 0))
+		goto_out;
+
+	if (inner_end < end) {
+		area.start = inner_end;
+		area.size = block_size;
+		if (!_io(&area, bounce, 0))
+			goto_out;
+		memcpy(buffer + (inner_end - start), bounce,
+		       (size_t) (end - inner_end));
+	}
+
+	r = 1;
+out:
+	dm_free(bounce_buf);
+	return r;
+}
+
 static int _aligned_io(struct device_area *where, char *buffer,
 		       int should_write)
 {
@@ -188,6 +259,13 @@ static int _aligned_io(struct device_area *where, char *buffer,
 	    !((uintptr_t) buffer & mask))
 		return _io(where, buffer, should_write);
 
+	/* Large reads into a suitably placed buffer need no full copy */
+	if (!should_write &&
+	    ((uintptr_t) buffer & mask) == (where->start & mask) &&
+	    ((where->start + mask) & ~mask) <
+	    ((where->start + where->size) & ~mask))
+		return _aligned_read_in_place(where, buffer, block_size);
+
 	/* Allocate a bounce buffer with an extra block */
 	if (!(bounce_buf = bounce = dm_malloc((size_t) widened.size + block_size))) {
 		log_error("Bounce buffer malloc failed");
@@ -331,6 +409,52 @@ static int _dev_discard_blocks(struct device *dev, uint64_t offset_bytes, uint64
 	return 1;
 }
 
+/*
+ * Ask the block layer to zero the whole blocks inside a range.  It uses
+ * WRITE SAME or discard where the device guarantees zeroes and writes
+ * the zeroes itself otherwise, without copying them from userspace.
+ * Returns 1 with the zeroed part of the range in zero_start/zero_len,
+ * or 0 if the caller must write the whole range itself.
+ */
+static int _dev_zero_out(struct device *dev, uint64_t offset, size_t len,
+			 uint64_t *zero_start, uint64_t *zero_len)
+{
+#ifdef BLKZEROOUT
+	uint64_t zero_range[2];
+	unsigned int block_size;
+	uint64_t mask;
+
+	if ((dev->flags & (DEV_REGULAR | DEV_NO_ZEROOUT | DEV_SKIP_WRITES)) ||
+	    !_get_block_size(dev, &block_size))
+		return 0;
+
+	mask = (uint64_t) block_size - 1;
+	zero_range[0] = (offset + mask) & ~mask;
+	if ((offset + len) <= zero_range[0])
+		return 0;
+	zero_range[1] = ((offset + len) & ~mask) - zero_range[0];
+	if (!zero_range[1])
+		return 0;
+
+	if (ioctl(dev_fd(dev), BLKZEROOUT, &zero_range) < 0) {
+		log_debug("%s: BLKZEROOUT ioctl at offset %" PRIu64 " size %"
+			  PRIu64 " failed: %s.", dev_name(dev), zero_range[0],
+			  zero_range[1], strerror(errno));
+		/* Don't retry where the kernel lacks the ioctl */
+		if (errno == ENOTTY || errno == EOPNOTSUPP || errno == EINVAL)
+			dev->flags |= DEV_NO_ZEROOUT;
+		return 0;
+	}
+
+	*zero_start = zero_range[0];
+	*zero_len = zero_range[1];
+
+	return 1;
+#else
+	return 0;
+#endif
+}
+
 /*-----------------------------------------------------------------
  * Public functions
  *---------------------------------------------------------------*/
@@ -411,6 +535,47 @@ void dev_flush(struct device *dev)
 	sync();
 }
 
+static void _close(struct device *dev);
+
+static void _fd_cache_del(struct device *dev)
+{
+	dm_list_del(&dev->fd_cache_list);
+	dev->flags &= ~DEV_FD_CACHED;
+	_fd_cache_count--;
+}
+
+/*
+ * Switch a cached fd to the I/O mode a fresh open would have used.
+ * Returns 0 if the fd has to be reopened instead.
+ */
+static int _fd_cache_set_direct(struct device *dev, int direct)
+{
+#ifdef O_DIRECT_SUPPORT
+	int flags;
+
+	if (direct && !(dev->flags & DEV_O_DIRECT_TESTED))
+		return 0;
+
+	direct = direct && (dev->flags & DEV_O_DIRECT);
+
+	if (!direct == !(dev->flags & DEV_OPENED_DIRECT))
+		return 1;
+
+	if ((flags = fcntl(dev->fd, F_GETFL)) < 0 ||
+	    fcntl(dev->fd, F_SETFL, direct ? (flags | O_DIRECT) :
+					     (flags & ~O_DIRECT)) < 0) {
+		log_sys_debug("fcntl", dev_name(dev));
+		return 0;
+	}
+
+	if (direct)
+		dev->flags |= DEV_OPENED_DIRECT;
+	else
+		dev->flags &= ~DEV_OPENED_DIRECT;
+#endif
+	return 1;
+}
+
 int dev_open_flags(struct device *dev, int flags, int direct, int quiet)
 {
 	struct stat buf;
@@ -423,6 +588,20 @@ int dev_open_flags(struct device *dev, int flags, int direct, int quiet)
 	if ((flags & O_EXCL))
 		need_excl = 1;
 
+	_fd_cache_opens++;
+
+	if (dev->fd >= 0 && (dev->flags & DEV_FD_CACHED)) {
+		_fd_cache_del(dev);
+		if (_fd_cache_set_direct(dev, direct) &&
+		    ((dev->flags & DEV_OPENED_RW) || !need_rw) &&
+		    ((dev->flags & DEV_OPENED_EXCL) || !need_excl)) {
+			_fd_cache_reused++;
+			dev->open_count++;
+			return 1;
+		}
+		_close(dev);
+	}
+
 	if (dev->fd >= 0) {
 		if (((dev->flags & DEV_OPENED_RW) || !need_rw) &&
 		    ((dev->flags & DEV_OPENED_EXCL) || !need_excl)) {
@@ -487,6 +666,11 @@ int dev_open_flags(struct device *dev, int flags, int direct, int quiet)
       opened:
 	if (direct)
 		dev->flags |= DEV_O_DIRECT_TESTED;
+
+	if (flags & O_DIRECT)
+		dev->flags |= DEV_OPENED_DIRECT;
+	else
+		dev->flags &= ~DEV_OPENED_DIRECT;
 #endif
 	dev->open_count++;
 	dev->flags &= ~DEV_ACCESSED_W;
@@ -568,6 +752,9 @@ int dev_test_excl(struct device *dev)
 
 static void _close(struct device *dev)
 {
+	if (dev->flags & DEV_FD_CACHED)
+		_fd_cache_del(dev);
+
 	if (close(dev->fd))
 		log_sys_error("close", dev_name(dev));
 	dev->fd = -1;
@@ -584,6 +771,34 @@ static void _close(struct device *dev)
 	}
 }
 
+/*
+ * Keep an unreferenced device open for a later dev_open, closing the
+ * least recently used one if the cache is full.  Device-mapper devices
+ * are left out: the command itself may need to deactivate them.
+ */
+static int _fd_cache_add(struct device *dev)
+{
+	struct device *lru;
+
+	if (!dev_open_fd_cache_size() ||
+	    (dev->flags & (DEV_ALLOCED | DEV_REGULAR)) ||
+	    (int) MAJOR(dev->dev) == dm_major())
+		return 0;
+
+	if (_fd_cache_count >= dev_open_fd_cache_size()) {
+		lru = dm_list_struct_base(dm_list_first(&_fd_cache),
+					  struct device, fd_cache_list);
+		_close(lru);
+		_fd_cache_evicted++;
+	}
+
+	dm_list_add(&_fd_cache, &dev->fd_cache_list);
+	dev->flags |= DEV_FD_CACHED;
+	_fd_cache_count++;
+
+	return 1;
+}
+
 static int _dev_close(struct device *dev, int immediate)
 {
 
@@ -606,8 +821,10 @@ static int _dev_close(struct device *dev, int immediate)
 			  dev_name(dev));
 
 	/* Close unless device is known to belong to a locked VG */
-	if (immediate ||
-	    (dev->open_count < 1 && !lvmcache_pvid_is_locked(dev->pvid)))
+	if (immediate)
+		_close(dev);
+	else if (dev->open_count < 1 && !lvmcache_pvid_is_locked(dev->pvid) &&
+		 !_fd_cache_add(dev))
 		_close(dev);
 
 	return 1;
@@ -623,11 +840,28 @@ int dev_close_immediate(struct device *dev)
 	return _dev_close(dev, 1);
 }
 
+void dev_close_cached(void)
+{
+	struct device *dev, *tmp;
+
+	if (!_fd_cache_count)
+		return;
+
+	log_debug("Closing %u cached device(s): %u of %u opens reused a "
+		  "cached descriptor, %u evicted.", _fd_cache_count,
+		  _fd_cache_reused, _fd_cache_opens, _fd_cache_evicted);
+
+	dm_list_iterate_items_gen_safe(dev, tmp, &_fd_cache, fd_cache_list)
+		_close(dev);
+}
+
 void dev_close_all(void)
 {
 	struct dm_list *doh, *doht;
 	struct device *dev;
 
+	dev_close_cached();
+
 	dm_list_iterate_safe(doh, doht, &_open_devices) {
 		dev = dm_list_struct_base(doh, struct device, open_list);
 		if (dev->open_count < 1)
@@ -734,6 +968,10 @@ int dev_write(struct device *dev, uint64_t offset, size_t len, void *buffer)
 	if (!_dev_is_valid(dev))
 		return 0;
 
+	/* Another process has already written the same data */
+	if (dev->flags & DEV_SKIP_WRITES)
+		return 1;
+
 	where.dev = dev;
 	where.start = offset;
 	where.size = len;
@@ -747,10 +985,43 @@ int dev_write(struct device *dev, uint64_t offset, size_t len, void *buffer)
 	return ret;
 }
 
-int dev_set(struct device *dev, uint64_t offset, size_t len, int value)
+/*
+ * Zero-filled chunks written by dev_set().  The buffer is page aligned and
+ * chunks after the first start on a DEV_SET_CHUNK_SIZE boundary, so every
+ * whole-block chunk goes straight to the device instead of being read back
+ * through a bounce buffer first.
+ */
+#define DEV_SET_CHUNK_SIZE (64 * 1024)
+
+/* Zeroing at least this much is left to the block layer */
+#define DEV_ZERO_OUT_MIN_SIZE (1024 * 1024)
+
+static int _dev_set_chunks(struct device *dev, uint64_t offset, size_t len,
+			   const char *buffer)
 {
 	size_t s;
-	char buffer[4096] __attribute__((aligned(8)));
+
+	while (len) {
+		s = DEV_SET_CHUNK_SIZE - (size_t) (offset % DEV_SET_CHUNK_SIZE);
+		if (s > len)
+			s = len;
+
+		if (!dev_write(dev, offset, s, (void *) buffer))
+			return_0;
+
+		len -= s;
+		offset += s;
+	}
+
+	return 1;
+}
+
+int dev_set(struct device *dev, uint64_t offset, size_t len, int value)
+{
+	size_t s, pagesize = lvm_getpagesize();
+	uint64_t zero_start, zero_len;
+	char *buffer, *buffer_buf;
+	int r = 0;
 
 	if (!dev_open(dev))
 		return_0;
@@ -763,23 +1034,37 @@ int dev_set(struct device *dev, uint64_t offset, size_t len, int value)
 			  " sectors", dev_name(dev), offset >> SECTOR_SHIFT,
 			  len >> SECTOR_SHIFT);
 
-	memset(buffer, value, sizeof(buffer));
-	while (1) {
-		s = len > sizeof(buffer) ? sizeof(buffer) : len;
-		if (!dev_write(dev, offset, s, buffer))
-			break;
+	s = len > DEV_SET_CHUNK_SIZE ? DEV_SET_CHUNK_SIZE : len;
+	if (!(buffer_buf = buffer = dm_malloc(s + pagesize))) {
+		log_error("Failed to allocate wipe buffer for %s.",
+			  dev_name(dev));
+		goto out;
+	}
 
-		len -= s;
-		if (!len)
-			break;
+	if (((uintptr_t) buffer) & (pagesize - 1))
+		buffer = (char *) ((((uintptr_t) buffer) + pagesize - 1) &
+				   ~((uintptr_t) pagesize - 1));
 
-		offset += s;
-	}
+	memset(buffer, value, s);
+
+	if (!value && len >= DEV_ZERO_OUT_MIN_SIZE &&
+	    _dev_zero_out(dev, offset, len, &zero_start, &zero_len)) {
+		/* Only the unaligned head and tail are left to write */
+		if (!_dev_set_chunks(dev, offset, (size_t) (zero_start - offset), buffer) ||
+		    !_dev_set_chunks(dev, zero_start + zero_len,
+				     (size_t) (offset + len - zero_start - zero_len),
+				     buffer))
+			goto_out;
+	} else if (!_dev_set_chunks(dev, offset, len, buffer))
+		goto_out;
 
+	r = 1;
+out:
+	dm_free(buffer_buf);
 	dev->flags |= DEV_ACCESSED_W;
 
 	if (!dev_close(dev))
 		stack;
 
-	return (len == 0);
+	return r;
 }
@@ -27,6 +27,10 @@
 #define DEV_OPENED_EXCL		0x00000010	/* Opened EXCL */
 #define DEV_O_DIRECT		0x00000020	/* Use O_DIRECT */
 #define DEV_O_DIRECT_TESTED	0x00000040	/* DEV_O_DIRECT is reliable */
+#define DEV_NO_ZEROOUT		0x00000080	/* BLKZEROOUT not supported */
+#define DEV_OPENED_DIRECT	0x00000100	/* Opened with O_DIRECT */
+#define DEV_FD_CACHED		0x00000200	/* Unreferenced fd kept open */
+#define DEV_SKIP_WRITES		0x00000400	/* Writes done by another process */
 
 /*
  * All devices in LVM will be represented by one of these.
@@ -46,6 +50,7 @@ struct device {
 	uint32_t flags;
 	uint64_t end;
 	struct dm_list open_list;
+	struct dm_list fd_cache_list;
 
 	char pvid[ID_LEN + 1];
 	char _padding[7];
@@ -80,6 +85,7 @@ int dev_open_readonly_quiet(struct device *dev);
 int dev_close(struct device *dev);
 int dev_close_immediate(struct device *dev);
 void dev_close_all(void);
+void dev_close_cached(void);
 int dev_test_excl(struct device *dev);
 
 int dev_fd(struct device *dev);
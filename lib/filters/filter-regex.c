@@ -21,8 +21,20 @@ struct rfilter {
 	struct dm_pool *mem;
 	dm_bitset_t accept;
 	struct dm_regex *engine;
+	unsigned count;
+	const char **patterns;	/* As given, to recognise them again */
 };
 
+/*
+ * The last few destroyed filters are kept so that recreating one with
+ * the same patterns, as happens each time the toolcontext is refreshed
+ * (twice per command run with --config through lvm2cmd), does not
+ * have to compile the matcher again.
+ */
+#define REGEX_FILTER_CACHE_SIZE 4
+static struct dev_filter *_cached_filters[REGEX_FILTER_CACHE_SIZE];
+static unsigned _cached_count = 0;
+
 static int _extract_pattern(struct dm_pool *mem, const char *pat,
 			    char **regex, dm_bitset_t accept, int ix)
 {
@@ -87,11 +99,155 @@ static int _extract_pattern(struct dm_pool *mem, const char *pat,
 	return 1;
 }
 
-static int _build_matcher(struct rfilter *rf, const struct dm_config_value *val)
+/*
+ * The compiled matcher is also saved to cache_file for the next command.
+ * The file starts with the patterns it was compiled from and is only used
+ * while they are identical, so any change to the filter simply causes it
+ * to be compiled and saved again.
+ */
+#define REGEX_CACHE_MAGIC 0x5247584c
+
+struct regex_cache_header {
+	uint32_t magic;
+	uint32_t count;
+	uint32_t patterns_size;	/* NUL-terminated, padded to 4 bytes */
+};
+
+static char *_cache_key(struct dm_pool *mem, const struct rfilter *rf, size_t *size)
+{
+	char *key, *ptr;
+	unsigned i;
+
+	*size = 0;
+	for (i = 0; i < rf->count; i++)
+		*size += strlen(rf->patterns[i]) + 1;
+	*size = (*size + 3) & ~(size_t) 3;
+
+	if (!(ptr = key = dm_pool_zalloc(mem, *size)))
+		return_NULL;
+
+	for (i = 0; i < rf->count; i++) {
+		strcpy(ptr, rf->patterns[i]);
+		ptr += strlen(ptr) + 1;
+	}
+
+	return key;
+}
+
+static struct dm_regex *_load_matcher(struct rfilter *rf, const char *file,
+				      const char *key, size_t key_size)
+{
+	struct regex_cache_header *hdr;
+	struct dm_regex *engine = NULL;
+	struct stat info;
+	char *buf = NULL;
+	int fd;
+
+	if ((fd = open(file, O_RDONLY)) < 0) {
+		if (errno != ENOENT)
+			log_sys_debug("open", file);
+		return NULL;
+	}
+
+	if (fstat(fd, &info)) {
+		log_sys_debug("fstat", file);
+		goto out;
+	}
+
+	if (info.st_size < (off_t) (sizeof(*hdr) + key_size))
+		goto out;
+
+	if (!(buf = dm_malloc(info.st_size))) {
+		log_error("Failed to allocate regex filter cache buffer.");
+		goto out;
+	}
+
+	if (read(fd, buf, info.st_size) != info.st_size) {
+		log_sys_debug("read", file);
+		goto out;
+	}
+
+	hdr = (struct regex_cache_header *) buf;
+	if (hdr->magic != REGEX_CACHE_MAGIC || hdr->count != rf->count ||
+	    hdr->patterns_size != key_size ||
+	    memcmp(buf + sizeof(*hdr), key, key_size)) {
+		log_debug("Regex filter cache %s is for other patterns.", file);
+		goto out;
+	}
+
+	if ((engine = dm_regex_import(rf->mem, rf->count, buf + sizeof(*hdr) + key_size,
+				      info.st_size - sizeof(*hdr) - key_size)))
+		log_debug("Loaded compiled regex filter from %s.", file);
+out:
+	if (close(fd))
+		log_sys_debug("close", file);
+	dm_free(buf);
+
+	return engine;
+}
+
+static void _save_matcher(struct dm_pool *mem, struct rfilter *rf, const char *file,
+			  const char *key, size_t key_size)
+{
+	struct regex_cache_header hdr = {
+		.magic = REGEX_CACHE_MAGIC,
+		.count = rf->count,
+		.patterns_size = key_size
+	};
+	char tmp_file[PATH_MAX];
+	void *data;
+	size_t size;
+	int fd, r;
+
+	if (!(data = dm_regex_export(rf->engine, mem, &size))) {
+		stack;
+		return;
+	}
+
+	/* Concurrent commands write identical files, so each uses its own. */
+	if (dm_snprintf(tmp_file, sizeof(tmp_file), "%s.%d.tmp", file, getpid()) < 0) {
+		log_debug("Regex filter cache filename too long.");
+		return;
+	}
+
+	if ((fd = open(tmp_file, O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0) {
+		/* A read-only /etc is fine: the filter just gets compiled each time. */
+		log_sys_debug("open", tmp_file);
+		return;
+	}
+
+	r = (write(fd, &hdr, sizeof(hdr)) == sizeof(hdr)) &&
+	    (write(fd, key, key_size) == (ssize_t) key_size) &&
+	    (write(fd, data, size) == (ssize_t) size);
+	if (!r)
+		log_sys_debug("write", tmp_file);
+
+	if (close(fd)) {
+		log_sys_debug("close", tmp_file);
+		r = 0;
+	}
+
+	if (r && rename(tmp_file, file)) {
+		log_sys_debug("rename", tmp_file);
+		r = 0;
+	}
+
+	if (!r) {
+		if (unlink(tmp_file))
+			log_sys_debug("unlink", tmp_file);
+		return;
+	}
+
+	log_debug("Saved compiled regex filter to %s.", file);
+}
+
+static int _build_matcher(struct rfilter *rf, const struct dm_config_value *val,
+			  const char *cache_file)
 {
 	struct dm_pool *scratch;
 	const struct dm_config_value *v;
-	char **regex;
+	char **regex, *key = NULL;
+	size_t key_size;
 	unsigned count = 0;
 	int i, r = 0;
 
@@ -116,6 +272,19 @@ static int _build_matcher(struct rfilter *rf, const struct dm_config_value *val)
 		goto out;
 	}
 
+	if (!(rf->patterns = dm_pool_alloc(rf->mem, sizeof(*rf->patterns) * count))) {
+		log_error("Failed to allocate patterns.");
+		goto out;
+	}
+
+	for (v = val, i = 0; v; v = v->next, i++)
+		if (!(rf->patterns[i] = dm_pool_strdup(rf->mem, v->v.str))) {
+			log_error("Failed to copy pattern.");
+			goto out;
+		}
+
+	rf->count = count;
+
 	/* Create the accept/reject bitset */
 	if (!(rf->accept = dm_bitset_create(rf->mem, count))) {
 		log_error("Failed to create bitset.");
@@ -133,6 +302,16 @@ static int _build_matcher(struct rfilter *rf, const struct dm_config_value *val)
 			goto out;
 		}
 
+	if (cache_file) {
+		if (!(key = _cache_key(scratch, rf, &key_size)))
+			goto_out;
+
+		if ((rf->engine = _load_matcher(rf, cache_file, key, key_size))) {
+			r = 1;
+			goto out;
+		}
+	}
+
 	/*
 	 * build the matcher.
 	 */
@@ -141,6 +320,9 @@ static int _build_matcher(struct rfilter *rf, const struct dm_config_value *val)
 		goto_out;
 	r = 1;
 
+	if (key)
+		_save_matcher(scratch, rf, cache_file, key, key_size);
+
       out:
 	dm_pool_destroy(scratch);
 	return r;
@@ -179,23 +361,64 @@ static int _accept_p(struct dev_filter *f, struct device *dev)
 	return !rejected;
 }
 
-static void _regex_destroy(struct dev_filter *f)
+static void _free_filter(struct dev_filter *f)
 {
-	struct rfilter *rf = (struct rfilter *) f->private;
+	dm_pool_destroy(((struct rfilter *) f->private)->mem);
+}
 
+static void _regex_destroy(struct dev_filter *f)
+{
 	if (f->use_count)
 		log_error(INTERNAL_ERROR "Destroying regex filter while in use %u times.", f->use_count);
 
-	dm_pool_destroy(rf->mem);
+	/* Drop the oldest */
+	if (_cached_count == REGEX_FILTER_CACHE_SIZE) {
+		_free_filter(_cached_filters[0]);
+		memmove(_cached_filters, _cached_filters + 1,
+			--_cached_count * sizeof(*_cached_filters));
+	}
+
+	_cached_filters[_cached_count++] = f;
 }
 
-struct dev_filter *regex_filter_create(const struct dm_config_value *patterns)
+static int _same_patterns(const struct rfilter *rf,
+			  const struct dm_config_value *val)
 {
-	struct dm_pool *mem = dm_pool_create("filter regex", 10 * 1024);
+	unsigned i;
+
+	for (i = 0; val; val = val->next, i++)
+		if (i == rf->count || val->type != DM_CFG_STRING ||
+		    strcmp(rf->patterns[i], val->v.str))
+			return 0;
+
+	return (i == rf->count);
+}
+
+void regex_filter_release_cache(void)
+{
+	while (_cached_count)
+		_free_filter(_cached_filters[--_cached_count]);
+}
+
+struct dev_filter *regex_filter_create(const struct dm_config_value *patterns,
+				       const char *cache_file)
+{
+	struct dm_pool *mem;
 	struct rfilter *rf;
 	struct dev_filter *f;
+	unsigned i;
+
+	for (i = 0; i < _cached_count; i++) {
+		f = _cached_filters[i];
+		if (!_same_patterns(f->private, patterns))
+			continue;
+		log_very_verbose("Reusing compiled regex filter.");
+		memmove(_cached_filters + i, _cached_filters + i + 1,
+			(--_cached_count - i) * sizeof(*_cached_filters));
+		return f;
+	}
 
-	if (!mem)
+	if (!(mem = dm_pool_create("filter regex", 10 * 1024)))
 		return_NULL;
 
 	if (!(rf = dm_pool_alloc(mem, sizeof(*rf))))
@@ -203,7 +426,7 @@ struct dev_filter *regex_filter_create(const struct dm_config_value *patterns)
 
 	rf->mem = mem;
 
-	if (!_build_matcher(rf, patterns))
+	if (!_build_matcher(rf, patterns, cache_file))
 		goto_bad;
 
 	if (!(f = dm_pool_zalloc(mem, sizeof(*f))))
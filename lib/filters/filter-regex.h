@@ -27,6 +27,17 @@
  * r|.*|             - reject everything else
  */
 
-struct dev_filter *regex_filter_create(const struct dm_config_value *patterns);
+/*
+ * If cache_file is set, the compiled matcher is loaded from it when it was
+ * saved there for the same patterns, and saved to it otherwise.
+ */
+struct dev_filter *regex_filter_create(const struct dm_config_value *patterns,
+				       const char *cache_file);
+
+/*
+ * Destroyed regex filters are kept for reuse by a later
+ * regex_filter_create() with identical patterns.  Free them.
+ */
+void regex_filter_release_cache(void);
 
 #endif
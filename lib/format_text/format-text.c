@@ -1616,12 +1616,18 @@ static char *_mda_export_text_raw(struct metadata_area *mda)
 	struct mda_context *mdc = (struct mda_context *) mda->metadata_locn;
 	char *result;
 
+	/* The scanned location and checksum let lvmetad spot unchanged metadata. */
 	dm_asprintf(&result,
 		    "ignore = %d "
 		    "start = %" PRIu64" "
 		    "size = %" PRIu64 " "
-		    "free_sectors = %" PRIu64,
-		    mda_is_ignored(mda), mdc->area.start, mdc->area.size, mdc->free_sectors);
+		    "free_sectors = %" PRIu64 " "
+		    "metadata_offset = %" PRIu64 " "
+		    "metadata_size = %" PRIu64 " "
+		    "metadata_checksum = %" PRIu32,
+		    mda_is_ignored(mda), mdc->area.start, mdc->area.size, mdc->free_sectors,
+		    mdc->scanned_rlocn.offset, mdc->scanned_rlocn.size,
+		    mdc->scanned_rlocn.checksum);
 
 	return result;
 }
@@ -285,13 +285,18 @@ static void _insert_segment(struct logical_volume *lv, struct lv_segment *seg)
 {
 	struct lv_segment *comp;
 
+	/* Segments are normally written out in order: append */
+	if (dm_list_empty(&lv->segments) ||
+	    dm_list_item(dm_list_last(&lv->segments), struct lv_segment)->le <= seg->le)
+		goto out;
+
 	dm_list_iterate_items(comp, &lv->segments) {
 		if (comp->le > seg->le) {
 			dm_list_add(&comp->list, &seg->list);
 			return;
 		}
 	}
-
+out:
 	lv->le_count += seg->len;
 	dm_list_add(&lv->segments, &seg->list);
 }
@@ -791,6 +796,9 @@ static struct volume_group *_read_vg(struct format_instance *fid,
 		goto bad;
 	}
 
+	/* Resolve LV names in segment areas through the hash */
+	vg->import_lv_hash = lv_hash;
+
 	if (!_read_sections(fid, "logical_volumes", _read_lvsegs, vg,
 			    vgn, pv_hash, lv_hash, 1, NULL)) {
 		log_error("Couldn't read all logical volumes for "
@@ -804,6 +812,7 @@ static struct volume_group *_read_vg(struct format_instance *fid,
 		goto bad;
 	}
 
+	vg->import_lv_hash = NULL;
 	dm_hash_destroy(pv_hash);
 	dm_hash_destroy(lv_hash);
 
@@ -817,6 +826,8 @@ static struct volume_group *_read_vg(struct format_instance *fid,
 	return vg;
 
       bad:
+	vg->import_lv_hash = NULL;
+
 	if (pv_hash)
 		dm_hash_destroy(pv_hash);
 
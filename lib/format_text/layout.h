@@ -80,6 +80,7 @@ struct mda_context {
 	struct device_area area;
 	uint64_t free_sectors;
 	struct raw_locn rlocn;	/* Store inbetween write and commit */
+	struct raw_locn scanned_rlocn;	/* Live metadata seen by the label scan */
 };
 
 /* FIXME Convert this at runtime */
@@ -238,6 +238,7 @@ int add_mda(const struct format_type *fmt, struct dm_pool *mem, struct dm_list *
 	mdac->area.size = size;
 	mdac->free_sectors = UINT64_C(0);
 	memset(&mdac->rlocn, 0, sizeof(mdac->rlocn));
+	memset(&mdac->scanned_rlocn, 0, sizeof(mdac->scanned_rlocn));
 	mda_set_ignored(mdal, ignored);
 
 	dm_list_add(mdas, &mdal->list);
@@ -293,6 +294,7 @@ static int _update_mda(struct metadata_area *mda, void *baton)
 	}
 
 	mda_set_ignored(mda, rlocn_is_ignored(mdah->raw_locns));
+	mdac->scanned_rlocn = mdah->raw_locns[0];
 
 	if (mda_is_ignored(mda)) {
 		log_debug("Ignoring mda on device %s at offset %"PRIu64,
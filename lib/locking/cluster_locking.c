@@ -404,7 +404,8 @@ static int _lock_for_cluster(struct cmd_context *cmd, unsigned char clvmd_cmd,
 /* API entry point for LVM */
 #ifdef CLUSTER_LOCKING_INTERNAL
 static int _lock_resource(struct cmd_context *cmd, const char *resource,
-			  uint32_t flags)
+			  uint32_t flags,
+			  struct logical_volume *lv __attribute__((unused)))
 #else
 int lock_resource(struct cmd_context *cmd, const char *resource, uint32_t flags)
 #endif
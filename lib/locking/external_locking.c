@@ -31,7 +31,8 @@ static int (*_init_fn) (int type, struct dm_config_tree * cft,
 static int (*_lock_query_fn) (const char *resource, int *mode) = NULL;
 
 static int _lock_resource(struct cmd_context *cmd, const char *resource,
-			  uint32_t flags)
+			  uint32_t flags,
+			  struct logical_volume *lv __attribute__((unused)))
 {
 	if (!_lock_fn)
 		return 0;
@@ -19,6 +19,7 @@ union lvid;
 struct volume_group;
 struct dm_list;
 struct lv_segment;
+struct lv_seg_index;
 struct replicator_device;
 
 struct logical_volume {
@@ -44,6 +45,7 @@ struct logical_volume {
 	struct dm_list rsites;	/* For replicators - all sites */
 
 	struct dm_list segments;
+	struct lv_seg_index *seg_index;	/* Segments ordered by LE for lookups */
 	struct dm_list tags;
 	struct dm_list segs_using_this_lv;
 
@@ -28,6 +28,8 @@
 #include "str_list.h"
 #include "defaults.h"
 
+#include <sys/time.h>
+
 typedef enum {
 	PREFERRED,
 	USE_AREA,
@@ -221,25 +223,27 @@ struct lv_segment *alloc_lv_segment(const struct segment_type *segtype,
 	struct lv_segment *seg;
 	struct dm_pool *mem = lv->vg->vgmem;
 	uint32_t areas_sz = area_count * sizeof(*seg->areas);
+	int raid;
 
 	if (!segtype) {
 		log_error(INTERNAL_ERROR "alloc_lv_segment: Missing segtype.");
 		return NULL;
 	}
 
-	if (!(seg = dm_pool_zalloc(mem, sizeof(*seg))))
-		return_NULL;
+	raid = segtype_is_raid(segtype);
 
-	if (!(seg->areas = dm_pool_zalloc(mem, areas_sz))) {
-		dm_pool_free(mem, seg);
+	/*
+	 * Keep the areas (and raid metadata areas) in the same allocation
+	 * straight after the segment, so walking segments and their
+	 * areas touches adjacent memory.
+	 */
+	if (!(seg = dm_pool_zalloc(mem, sizeof(*seg) +
+				   (raid ? 2 : 1) * areas_sz)))
 		return_NULL;
-	}
 
-	if (segtype_is_raid(segtype) &&
-	    !(seg->meta_areas = dm_pool_zalloc(mem, areas_sz))) {
-		dm_pool_free(mem, seg); /* frees everything alloced since seg */
-		return_NULL;
-	}
+	seg->areas = (struct lv_segment_area *) (seg + 1);
+	if (raid)
+		seg->meta_areas = seg->areas + area_count;
 
 	seg->segtype = segtype;
 	seg->lv = lv;
@@ -2190,6 +2194,8 @@ int lv_add_segment(struct alloc_handle *ah,
 		   uint64_t status,
 		   uint32_t region_size)
 {
+	struct lv_segment *last_seg;
+
 	if (!segtype) {
 		log_error("Missing segtype in lv_add_segment().");
 		return 0;
@@ -2205,13 +2211,18 @@ int lv_add_segment(struct alloc_handle *ah,
 		return 0;
 	}
 
+	/* New segments are appended: only they can need merging */
+	last_seg = dm_list_empty(&lv->segments) ? NULL :
+		dm_list_item(dm_list_last(&lv->segments), struct lv_segment);
+
 	if (!_setup_alloced_segments(lv, &ah->alloced_areas[first_area],
 				     num_areas, status,
 				     stripe_size, segtype,
 				     region_size))
 		return_0;
 
-	if ((segtype->flags & SEG_CAN_SPLIT) && !lv_merge_segments(lv)) {
+	if ((segtype->flags & SEG_CAN_SPLIT) &&
+	    !lv_merge_segments_from(lv, last_seg)) {
 		log_error("Couldn't merge segments after extending "
 			  "logical volume.");
 		return 0;
@@ -3999,6 +4010,8 @@ int set_lv(struct cmd_context *cmd, struct logical_volume *lv,
 	   uint64_t sectors, int value)
 {
 	struct device *dev;
+	struct timeval start, end;
+	double elapsed;
 	char *name;
 
 	/*
@@ -4037,8 +4050,21 @@ int set_lv(struct cmd_context *cmd, struct logical_volume *lv,
 	if (sectors > lv->size)
 		sectors = lv->size;
 
+	if (gettimeofday(&start, NULL))
+		timerclear(&start);
+
 	if (!dev_set(dev, UINT64_C(0), (size_t) sectors << SECTOR_SHIFT, value))
 		stack;
+	/* Report throughput of the larger clears such as whole metadata LVs */
+	else if (timerisset(&start) && !gettimeofday(&end, NULL) &&
+		 sectors > (UINT64_C(4096) >> SECTOR_SHIFT)) {
+		timersub(&end, &start, &end);
+		elapsed = end.tv_sec + end.tv_usec / 1000000.0;
+		log_verbose("Cleared %s of logical volume \"%s\" in %.2f seconds"
+			    " (%.1f MiB/s).", display_size(cmd, sectors),
+			    lv->name, elapsed, elapsed > 0 ?
+			    (sectors << SECTOR_SHIFT) / elapsed / (1024 * 1024) : 0.0);
+	}
 
 	dev_flush(dev);
 
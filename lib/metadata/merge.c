@@ -37,6 +37,11 @@ static int _merge(struct lv_segment *first, struct lv_segment *second)
 }
 
 int lv_merge_segments(struct logical_volume *lv)
+{
+	return lv_merge_segments_from(lv, NULL);
+}
+
+int lv_merge_segments_from(struct logical_volume *lv, struct lv_segment *seg)
 {
 	struct dm_list *segh, *t;
 	struct lv_segment *current, *prev = NULL;
@@ -44,7 +49,15 @@ int lv_merge_segments(struct logical_volume *lv)
 	if (lv->status & LOCKED || lv->status & PVMOVE)
 		return 1;
 
-	dm_list_iterate_safe(segh, t, &lv->segments) {
+	/* Earlier segments were merged already: start with seg */
+	if (seg) {
+		prev = seg;
+		segh = seg->list.n;
+	} else
+		segh = dm_list_first(&lv->segments) ? : &lv->segments;
+
+	for (; segh != &lv->segments; segh = t) {
+		t = segh->n;
 		current = dm_list_item(segh, struct lv_segment);
 
 		if (_merge(prev, current))
@@ -502,6 +515,7 @@ static int _lv_split_segment(struct logical_volume *lv, struct lv_segment *seg,
 
 	/* Add split off segment to the list _after_ the original one */
 	dm_list_add_h(&seg->list, &split_seg->list);
+	lv_seg_index_split(seg, split_seg);
 
 	return 1;
 }
@@ -523,11 +537,12 @@ int lv_split_segment(struct logical_volume *lv, uint32_t le)
 	if (le == seg->le)
 		return 1;
 
+	/*
+	 * The whole VG is validated again before it is written, so
+	 * don't walk it after each of possibly many splits.
+	 */
 	if (!_lv_split_segment(lv, seg, le))
 		return_0;
 
-	if (!vg_validate(lv->vg))
-		return_0;
-
 	return 1;
 }
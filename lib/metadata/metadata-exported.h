@@ -399,12 +399,16 @@ struct pvcreate_params {
 	force_t force;
 	unsigned yes;
 	unsigned metadataignore;
+	struct dm_list *no_signature_devs; /* Set by pvcreate_probe_devices */
 };
 
 struct physical_volume *pvcreate_single(struct cmd_context *cmd,
 					const char *pv_name,
 					struct pvcreate_params *pp,
 					int write_now);
+int pvcreate_probe_devices(struct cmd_context *cmd, struct pvcreate_params *pp,
+			   int pv_count, char *const *pv_names);
+int pvcreate_write_pvs(struct cmd_context *cmd, struct dm_list *pvs_to_create);
 void pvcreate_params_set_defaults(struct pvcreate_params *pp);
 
 /*
@@ -789,6 +793,9 @@ int lv_raid_reshape(struct logical_volume *lv,
 		    const struct segment_type *new_segtype);
 int lv_raid_replace(struct logical_volume *lv, struct dm_list *remove_pvs,
 		    struct dm_list *allocate_pvs);
+int lv_raid_replace_lvs(struct volume_group *vg, struct dm_list *lvs,
+			struct dm_list *remove_pvs,
+			struct dm_list *allocate_pvs);
 
 /* --  metadata/raid_manip.c */
 
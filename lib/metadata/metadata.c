@@ -34,6 +34,7 @@
 
 #include <math.h>
 #include <sys/param.h>
+#include <sys/wait.h>
 
 static struct physical_volume *_pv_read(struct cmd_context *cmd,
 					struct dm_pool *pvmem,
@@ -310,6 +311,9 @@ static int _copy_pv(struct dm_pool *pvmem,
 	pv_to->fid = NULL;
 	pv_set_fid(pv_to, pv_from->fid);
 
+	/* The index refers to pv_from's segments */
+	pv_to->seg_index = NULL;
+
 	if (!(pv_to->vg_name = dm_pool_strdup(pvmem, pv_from->vg_name)))
 		return_0;
 
@@ -579,7 +583,7 @@ int vg_remove(struct volume_group *vg)
 	struct pv_list *pvl;
 	int ret = 1;
 
-	if (!lock_vol(vg->cmd, VG_ORPHANS, LCK_VG_WRITE)) {
+	if (!lock_vol(vg->cmd, VG_ORPHANS, LCK_VG_WRITE, NULL)) {
 		log_error("Can't get lock for orphan PVs");
 		return 0;
 	}
@@ -677,26 +681,34 @@ int vg_extend(struct volume_group *vg, int pv_count, const char *const *pv_names
 	      struct pvcreate_params *pp)
 {
 	int i;
-	char *pv_name;
+	char **names;
 
 	if (_vg_bad_status_bits(vg, RESIZEABLE_VG))
 		return 0;
 
-	/* attach each pv */
+	if (!(names = dm_pool_alloc(vg->vgmem, pv_count * sizeof(*names)))) {
+		log_error("Failed to allocate pv name list.");
+		return 0;
+	}
+
 	for (i = 0; i < pv_count; i++) {
-		if (!(pv_name = dm_strdup(pv_names[i]))) {
+		if (!(names[i] = dm_pool_strdup(vg->vgmem, pv_names[i]))) {
 			log_error("Failed to duplicate pv name %s.", pv_names[i]);
 			return 0;
 		}
-		dm_unescape_colons_and_at_signs(pv_name, NULL, NULL);
-		if (!vg_extend_single_pv(vg, pv_name, pp)) {
+		dm_unescape_colons_and_at_signs(names[i], NULL, NULL);
+	}
+
+	if (pp && !pvcreate_probe_devices(vg->cmd, pp, pv_count, names))
+		return_0;
+
+	/* attach each pv */
+	for (i = 0; i < pv_count; i++)
+		if (!vg_extend_single_pv(vg, names[i], pp)) {
 			log_error("Unable to add physical volume '%s' to "
-				  "volume group '%s'.", pv_name, vg->name);
-			dm_free(pv_name);
+				  "volume group '%s'.", names[i], vg->name);
 			return 0;
 		}
-		dm_free(pv_name);
-	}
 
 /* FIXME Decide whether to initialise and add new mdahs to format instance */
 
@@ -1315,6 +1327,21 @@ static int _wipe_sb(struct device *dev, const char *type, const char *name,
 	return 1;
 }
 
+static int _pv_probed_without_signatures(struct pvcreate_params *pp,
+					 struct device *dev)
+{
+	struct device_list *devl;
+
+	if (!pp->no_signature_devs)
+		return 0;
+
+	dm_list_iterate_items(devl, pp->no_signature_devs)
+		if (devl->dev == dev)
+			return 1;
+
+	return 0;
+}
+
 /*
  * See if we may pvcreate on this device.
  * 0 indicates we may not.
@@ -1389,13 +1416,12 @@ static int pvcreate_check(struct cmd_context *cmd, const char *name,
 		goto bad;
 	}
 
-	if (!_wipe_sb(dev, "software RAID md superblock", name, 4, pp, dev_is_md))
-		goto_bad;
-
-	if (!_wipe_sb(dev, "swap signature", name, 10, pp, dev_is_swap))
-		goto_bad;
-
-	if (!_wipe_sb(dev, "LUKS signature", name, 8, pp, dev_is_luks))
+	if (_pv_probed_without_signatures(pp, dev))
+		log_debug("%s: Already probed for md, swap and LUKS signatures.",
+			  name);
+	else if (!_wipe_sb(dev, "software RAID md superblock", name, 4, pp, dev_is_md) ||
+		 !_wipe_sb(dev, "swap signature", name, 10, pp, dev_is_swap) ||
+		 !_wipe_sb(dev, "LUKS signature", name, 8, pp, dev_is_luks))
 		goto_bad;
 
 	if (sigint_caught())
@@ -1435,6 +1461,7 @@ void pvcreate_params_set_defaults(struct pvcreate_params *pp)
 	pp->force = PROMPT;
 	pp->yes = 0;
 	pp->metadataignore = DEFAULT_PVMETADATAIGNORE;
+	pp->no_signature_devs = NULL;
 }
 
 
@@ -1476,10 +1503,227 @@ static int _pvcreate_write(struct cmd_context *cmd, struct pv_to_create *pvc)
 		return 0;
 	}
 
-	log_print("Physical volume \"%s\" successfully created", pv_name);
 	return 1;
 }
 
+struct pv_child {
+	const char *pv_name;
+	void *data;	/* NULL if the device is left to this process */
+	pid_t pid;
+	int r;		/* Set if the child succeeded */
+};
+
+/*
+ * Run fn(cmd, child->data) in a new process.
+ * Returns the pid of the child or 0 if it could not be started.
+ */
+static pid_t _pv_child_fork(struct cmd_context *cmd, struct pv_child *child,
+			    int (*fn)(struct cmd_context *cmd, void *data))
+{
+	pid_t pid;
+	int r;
+
+	/* Don't let the child repeat output still buffered here */
+	fflush(stdout);
+	fflush(stderr);
+
+	if ((pid = fork()) == -1) {
+		log_sys_error("fork", child->pv_name);
+		return 0;
+	}
+
+	if (pid)
+		return pid;
+
+	/* Child: lvmetad is told by the parent */
+	lvmetad_set_active(0);
+	r = fn(cmd, child->data);
+	fflush(stdout);
+	fflush(stderr);
+	_exit(r ? 0 : 1);
+}
+
+static void _pv_child_wait(struct pv_child *child)
+{
+	int status;
+
+	while (waitpid(child->pid, &status, 0) != child->pid)
+		if (errno != EINTR) {
+			log_sys_error("waitpid", child->pv_name);
+			return;
+		}
+
+	if (!WIFEXITED(status)) {
+		log_error("Process for %s exited abnormally.", child->pv_name);
+		return;
+	}
+
+	/* The child has reported what went wrong */
+	child->r = !WEXITSTATUS(status);
+}
+
+/*
+ * Call fn for each child with data set in a process of its own,
+ * with up to pv_init_parallelism() of them running at once.
+ */
+static void _pv_children_run(struct cmd_context *cmd,
+			     struct pv_child *children, unsigned count,
+			     int (*fn)(struct cmd_context *cmd, void *data))
+{
+	unsigned parallelism = pv_init_parallelism();
+	unsigned i, oldest = 0, running = 0;
+
+	for (i = 0; i < count; i++) {
+		if (!children[i].data)
+			continue;
+
+		for (; running == parallelism; oldest++)
+			if (children[oldest].pid) {
+				_pv_child_wait(&children[oldest]);
+				running--;
+			}
+
+		if ((children[i].pid = _pv_child_fork(cmd, &children[i], fn)))
+			running++;
+	}
+
+	for (; running; oldest++)
+		if (children[oldest].pid) {
+			_pv_child_wait(&children[oldest]);
+			running--;
+		}
+}
+
+static int _pv_probe_no_signatures(struct cmd_context *cmd, void *data)
+{
+	struct device *dev = data;
+	uint64_t signature;
+
+	return !dev_is_md(dev, NULL) && !dev_is_swap(dev, &signature) &&
+	       !dev_is_luks(dev, &signature);
+}
+
+/*
+ * Look for md, swap and LUKS signatures on the named devices, up to
+ * pv_init_parallelism() of them at a time, before pvcreate_check()
+ * reads them one after another.  Devices found without any are
+ * recorded in pp, and pvcreate_check() skips looking for them again.
+ */
+int pvcreate_probe_devices(struct cmd_context *cmd, struct pvcreate_params *pp,
+			   int pv_count, char *const *pv_names)
+{
+	struct pv_child *children;
+	struct device_list *devl;
+	int i;
+
+	if (pv_count < 2 || pv_init_parallelism() < 2)
+		return 1;
+
+	if (!(children = dm_pool_zalloc(cmd->mem, pv_count * sizeof(*children))) ||
+	    !(pp->no_signature_devs = dm_pool_alloc(cmd->mem,
+						    sizeof(*pp->no_signature_devs)))) {
+		log_error("Failed to allocate device probe list.");
+		return 0;
+	}
+	dm_list_init(pp->no_signature_devs);
+
+	for (i = 0; i < pv_count; i++) {
+		children[i].pv_name = pv_names[i];
+		children[i].data = dev_cache_get(pv_names[i], cmd->filter);
+	}
+
+	_pv_children_run(cmd, children, (unsigned) pv_count,
+			 _pv_probe_no_signatures);
+
+	for (i = 0; i < pv_count; i++) {
+		if (!children[i].r)
+			continue;
+
+		if (!(devl = dm_pool_alloc(cmd->mem, sizeof(*devl)))) {
+			log_error("Failed to allocate device probe list.");
+			return 0;
+		}
+		devl->dev = children[i].data;
+		dm_list_add(pp->no_signature_devs, &devl->list);
+	}
+
+	return 1;
+}
+
+static int _pv_write_child(struct cmd_context *cmd, void *data)
+{
+	return _pvcreate_write(cmd, data);
+}
+
+/*
+ * Write labels and metadata areas of the PVs on pvs_to_create.
+ *
+ * With pv_init_parallelism() above 1, child processes write the devices
+ * concurrently.  lvmcache and the lvmetad connection belong to this
+ * process, so each device a child wrote successfully then goes through
+ * _pvcreate_write() here again with DEV_SKIP_WRITES set, which updates
+ * lvmcache and lvmetad without writing anything.
+ *
+ * A failure on one device does not stop the others being written.
+ */
+int pvcreate_write_pvs(struct cmd_context *cmd, struct dm_list *pvs_to_create)
+{
+	unsigned count = dm_list_size(pvs_to_create);
+	struct pv_child *children = NULL;
+	struct pv_to_create *pvc, *pvc2;
+	unsigned i;
+	int r = 1, written;
+
+	if (count > 1 && pv_init_parallelism() > 1 && !test_mode()) {
+		if (!(children = dm_pool_zalloc(cmd->mem, count * sizeof(*children)))) {
+			log_error("Failed to allocate process list.");
+			return 0;
+		}
+
+		i = 0;
+		dm_list_iterate_items(pvc, pvs_to_create) {
+			children[i].pv_name = pv_dev_name(pvc->pv);
+			children[i].data = pvc;
+			/* A device listed twice is written here afterwards */
+			dm_list_iterate_items(pvc2, pvs_to_create) {
+				if (pvc2 == pvc)
+					break;
+				if (pvc2->pv->dev == pvc->pv->dev) {
+					children[i].data = NULL;
+					break;
+				}
+			}
+			i++;
+		}
+
+		_pv_children_run(cmd, children, count, _pv_write_child);
+	}
+
+	i = 0;
+	dm_list_iterate_items(pvc, pvs_to_create) {
+		if (children && children[i].pid) {
+			if ((written = children[i].r)) {
+				pvc->pv->dev->flags |= DEV_SKIP_WRITES;
+				written = _pvcreate_write(cmd, pvc);
+				pvc->pv->dev->flags &= ~DEV_SKIP_WRITES;
+			}
+		} else
+			written = _pvcreate_write(cmd, pvc);
+		i++;
+
+		if (!written) {
+			r = 0;
+			continue;
+		}
+
+		pvc->pv->status &= ~UNLABELLED_PV;
+		log_print("Physical volume \"%s\" successfully created",
+			  pv_dev_name(pvc->pv));
+	}
+
+	return r;
+}
+
 /*
  * pvcreate_single() - initialize a device with PV label and metadata area
  *
@@ -1551,6 +1795,8 @@ struct physical_volume * pvcreate_single(struct cmd_context *cmd,
 		pvc.pv = pv;
 		if (!_pvcreate_write(cmd, &pvc))
 			goto bad;
+		log_print("Physical volume \"%s\" successfully created",
+			  pv_name);
 	} else {
 		pv->status |= UNLABELLED_PV;
 	}
@@ -1818,7 +2064,20 @@ struct lv_list *find_lv_in_vg_by_lvid(struct volume_group *vg,
 struct logical_volume *find_lv(const struct volume_group *vg,
 			       const char *lv_name)
 {
-	struct lv_list *lvl = find_lv_in_vg(vg, lv_name);
+	struct lv_list *lvl;
+	const char *ptr;
+
+	if (vg->import_lv_hash) {
+		/* Use last component */
+		if ((ptr = strrchr(lv_name, '/')))
+			ptr++;
+		else
+			ptr = lv_name;
+
+		return dm_hash_lookup(vg->import_lv_hash, ptr);
+	}
+
+	lvl = find_lv_in_vg(vg, lv_name);
 	return lvl ? lvl->lv : NULL;
 }
 
@@ -1874,11 +2133,135 @@ bad:
 	return NULL;
 }
 
+/*
+ * LVs with more segments than this get an array of their segments
+ * ordered by LE, so lookups by LE need a binary search only.
+ * The array is rebuilt whenever a lookup finds it out of date,
+ * so code changing lv->segments does not need to maintain it.
+ */
+#define SEG_INDEX_MIN_SEGMENTS 16
+
+struct lv_seg_index {
+	uint32_t count;
+	uint32_t size;
+	struct lv_segment **segs;
+};
+
+static int _seg_linked_to_lv(const struct logical_volume *lv,
+			     const struct lv_segment *seg)
+{
+	/* Neighbours of a removed segment no longer point back at it */
+	return (seg->lv == lv &&
+		seg->list.n->p == &seg->list &&
+		seg->list.p->n == &seg->list);
+}
+
+/* Returns position of the segment containing le in the index or -1 */
+static int _seg_index_find(const struct logical_volume *lv, uint32_t le)
+{
+	const struct lv_seg_index *idx = lv->seg_index;
+	struct lv_segment *seg;
+	uint32_t lo = 0, hi, mid;
+
+	if (!idx || !idx->count)
+		return -1;
+
+	/* Last segment starting at or before le */
+	hi = idx->count;
+	while (hi - lo > 1) {
+		mid = lo + (hi - lo) / 2;
+		if (idx->segs[mid]->le <= le)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	seg = idx->segs[lo];
+	if (le >= seg->le && le < seg->le + seg->len &&
+	    _seg_linked_to_lv(lv, seg))
+		return (int) lo;
+
+	return -1;
+}
+
+static int _seg_index_build(struct logical_volume *lv)
+{
+	struct lv_seg_index *idx = lv->seg_index;
+	struct lv_segment *seg;
+	uint32_t count = dm_list_size(&lv->segments);
+	uint32_t size;
+
+	if (!idx && !(idx = lv->seg_index = dm_pool_zalloc(lv->vg->vgmem,
+							    sizeof(*idx))))
+		return_0;
+
+	if (count > idx->size) {
+		size = (count > 2 * idx->size) ? count : 2 * idx->size;
+		idx->count = idx->size = 0;
+		if (!(idx->segs = dm_pool_alloc(lv->vg->vgmem,
+						size * sizeof(*idx->segs))))
+			return_0;
+		idx->size = size;
+	}
+
+	idx->count = 0;
+	dm_list_iterate_items(seg, &lv->segments)
+		idx->segs[idx->count++] = seg;
+
+	return 1;
+}
+
+/*
+ * Record split_seg which has just been split off the end of seg and
+ * added after it, so that splitting does not force a rebuild.
+ */
+void lv_seg_index_split(struct lv_segment *seg, struct lv_segment *split_seg)
+{
+	struct lv_seg_index *idx = seg->lv->seg_index;
+	int pos;
+
+	if (!idx || !idx->count)
+		return;
+
+	if ((pos = _seg_index_find(seg->lv, seg->le)) < 0 ||
+	    idx->segs[pos] != seg || idx->count == idx->size) {
+		/* Leave it to the next lookup to rebuild */
+		idx->count = 0;
+		return;
+	}
+
+	memmove(idx->segs + pos + 2, idx->segs + pos + 1,
+		(idx->count - pos - 1) * sizeof(*idx->segs));
+	idx->segs[pos + 1] = split_seg;
+	idx->count++;
+}
+
 /* Find segment at a given logical extent in an LV */
 struct lv_segment *find_seg_by_le(const struct logical_volume *lv, uint32_t le)
 {
 	struct lv_segment *seg;
+	uint32_t count = 0;
+	int pos;
+
+	if ((pos = _seg_index_find(lv, le)) >= 0)
+		return lv->seg_index->segs[pos];
 
+	dm_list_iterate_items(seg, &lv->segments) {
+		if (le >= seg->le && le < seg->le + seg->len)
+			return seg;
+		if (++count == SEG_INDEX_MIN_SEGMENTS)
+			break;
+	}
+
+	if (count < SEG_INDEX_MIN_SEGMENTS || !lv->vg)
+		return NULL;
+
+	/* Cast: the index is only a cache of lv->segments. */
+	if (_seg_index_build((struct logical_volume *) lv) &&
+	    (pos = _seg_index_find(lv, le)) >= 0)
+		return lv->seg_index->segs[pos];
+
+	/* Not mapped or the list is not ordered */
 	dm_list_iterate_items(seg, &lv->segments)
 		if (le >= seg->le && le < seg->le + seg->len)
 			return seg;
@@ -2441,6 +2824,13 @@ int vg_validate(struct volume_group *vg)
 		 */
 	}
 
+	if (num_snapshots != vg->cow_count) {
+		log_error(INTERNAL_ERROR "#snapshots (%" PRIu32 ") != "
+			  "cached #snapshots (%" PRIu32 ") in VG %s",
+			  num_snapshots, vg->cow_count, vg->name);
+		r = 0;
+	}
+
 	/*
 	 * all volumes = visible LVs + snapshot_cows + invisible LVs
 	 */
@@ -2559,7 +2949,6 @@ out:
 int vg_write(struct volume_group *vg)
 {
 	struct dm_list *mdah;
-        struct pv_to_create *pv_to_create;
 	struct metadata_area *mda;
 
 	if (!vg_validate(vg))
@@ -2603,11 +2992,8 @@ int vg_write(struct volume_group *vg)
 	memlock_unlock(vg->cmd);
 	vg->seqno++;
 
-        dm_list_iterate_items(pv_to_create, &vg->pvs_to_create) {
-		if (!_pvcreate_write(vg->cmd, pv_to_create))
-			return 0;
-		pv_to_create->pv->status &= ~UNLABELLED_PV;
-        }
+	if (!pvcreate_write_pvs(vg->cmd, &vg->pvs_to_create))
+		return 0;
 
 	/* Write to each copy of the metadata area */
 	dm_list_iterate_items(mda, &vg->fid->metadata_areas_in_use) {
@@ -3967,7 +4353,7 @@ static struct volume_group *_recover_vg(struct cmd_context *cmd,
 
 	dev_close_all();
 
-	if (!lock_vol(cmd, vg_name, LCK_VG_WRITE))
+	if (!lock_vol(cmd, vg_name, LCK_VG_WRITE, NULL))
 		return_NULL;
 
 	if (!(vg = vg_read_internal(cmd, vg_name, vgid, 1, &consistent)))
@@ -4014,7 +4400,7 @@ static struct volume_group *_vg_lock_and_read(struct cmd_context *cmd, const cha
 	already_locked = lvmcache_vgname_is_locked(vg_name);
 
 	if (!already_locked && !(misc_flags & READ_WITHOUT_LOCK) &&
-	    !lock_vol(cmd, vg_name, lock_flags)) {
+	    !lock_vol(cmd, vg_name, lock_flags, NULL)) {
 		log_error("Can't get lock for %s", vg_name);
 		return _vg_make_handle(cmd, vg, FAILED_LOCKING);
 	}
@@ -4169,7 +4555,7 @@ uint32_t vg_read_error(struct volume_group *vg_handle)
  */
 uint32_t vg_lock_newname(struct cmd_context *cmd, const char *vgname)
 {
-	if (!lock_vol(cmd, vgname, LCK_VG_WRITE)) {
+	if (!lock_vol(cmd, vgname, LCK_VG_WRITE, NULL)) {
 		return FAILED_LOCKING;
 	}
 
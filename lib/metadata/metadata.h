@@ -409,11 +409,23 @@ int check_replicator_segment(const struct lv_segment *replicator_seg);
  */
 int lv_merge_segments(struct logical_volume *lv);
 
+/*
+ * As lv_merge_segments, but only try segments after seg, which must
+ * not be mergeable with any segment before it (eg, after appending).
+ */
+int lv_merge_segments_from(struct logical_volume *lv, struct lv_segment *seg);
+
 /*
  * Ensure there's a segment boundary at a given LE, splitting if necessary
  */
 int lv_split_segment(struct logical_volume *lv, uint32_t le);
 
+/*
+ * Update the segment lookup index after split_seg has been split off
+ * the end of seg and added after it.
+ */
+void lv_seg_index_split(struct lv_segment *seg, struct lv_segment *split_seg);
+
 /*
  * Add/remove upward link from underlying LV to the segment using it
  * FIXME: ridiculously long name
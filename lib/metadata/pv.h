@@ -19,6 +19,7 @@ struct id;
 struct device;
 struct format_type;
 struct volume_group;
+struct pv_seg_index;
 
 struct physical_volume {
 	struct id id;
@@ -58,6 +59,7 @@ struct physical_volume {
 	uint64_t label_sector;
 
 	struct dm_list segments;	/* Ordered pv_segments covering complete PV */
+	struct pv_seg_index *seg_index;	/* Segments ordered by PE for lookups */
 	struct dm_list tags;
 };
 
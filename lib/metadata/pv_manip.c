@@ -79,13 +79,137 @@ int peg_dup(struct dm_pool *mem, struct dm_list *peg_new, struct dm_list *peg_ol
 	return 1;
 }
 
+/*
+ * PVs with more segments than this get an array of their segments
+ * ordered by PE.  Splits keep it up to date; other changes to
+ * pv->segments make a lookup miss, which rebuilds it.
+ */
+#define PEG_INDEX_MIN_SEGMENTS 16
+
+struct pv_seg_index {
+	uint32_t count;
+	uint32_t size;
+	struct pv_segment **pegs;
+};
+
+/* Returns position of the segment containing pe in the index or -1 */
+static int _peg_index_find(const struct physical_volume *pv, uint32_t pe)
+{
+	const struct pv_seg_index *idx = pv->seg_index;
+	const struct pv_segment *peg;
+	uint32_t lo = 0, hi, mid;
+
+	if (!idx || !idx->count)
+		return -1;
+
+	hi = idx->count;
+	while (hi - lo > 1) {
+		mid = lo + (hi - lo) / 2;
+		if (idx->pegs[mid]->pe <= pe)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	peg = idx->pegs[lo];
+	/* Neighbours of a removed segment no longer point back at it */
+	if (pe >= peg->pe && pe < peg->pe + peg->len &&
+	    peg->list.n->p == &peg->list && peg->list.p->n == &peg->list)
+		return (int) lo;
+
+	return -1;
+}
+
+static int _peg_index_build(struct dm_pool *mem, struct physical_volume *pv)
+{
+	struct pv_seg_index *idx = pv->seg_index;
+	struct pv_segment *peg;
+	uint32_t count = dm_list_size(&pv->segments);
+	uint32_t size;
+
+	if (!idx && !(idx = pv->seg_index = dm_pool_zalloc(mem, sizeof(*idx))))
+		return_0;
+
+	idx->count = 0;
+
+	if (count > idx->size) {
+		size = (count > 2 * idx->size) ? count : 2 * idx->size;
+		if (!(idx->pegs = dm_pool_alloc(mem, size * sizeof(*idx->pegs)))) {
+			idx->size = 0;
+			return_0;
+		}
+		idx->size = size;
+	}
+
+	dm_list_iterate_items(peg, &pv->segments)
+		idx->pegs[idx->count++] = peg;
+
+	return 1;
+}
+
+/* Record peg_new which was split off the segment at position pos */
+static void _peg_index_insert(struct physical_volume *pv, int pos,
+			      struct pv_segment *peg_new)
+{
+	struct pv_seg_index *idx = pv->seg_index;
+
+	if (pos < 0)
+		return;
+
+	/* Full: leave it to the next lookup to rebuild */
+	if (idx->count == idx->size) {
+		idx->count = 0;
+		return;
+	}
+
+	memmove(idx->pegs + pos + 2, idx->pegs + pos + 1,
+		(idx->count - pos - 1) * sizeof(*idx->pegs));
+	idx->pegs[pos + 1] = peg_new;
+	idx->count++;
+}
+
+/* Forget peg2 which has just been merged into the segment before it */
+static void _peg_index_remove(struct physical_volume *pv,
+			      struct pv_segment *peg2)
+{
+	struct pv_seg_index *idx = pv->seg_index;
+	int pos;
+
+	if ((pos = _peg_index_find(pv, peg2->pe - 1)) < 0 ||
+	    (unsigned) pos + 1 >= idx->count || idx->pegs[pos + 1] != peg2) {
+		/* Out of date: leave it to the next lookup to rebuild */
+		idx->count = 0;
+		return;
+	}
+
+	memmove(idx->pegs + pos + 1, idx->pegs + pos + 2,
+		(idx->count - pos - 2) * sizeof(*idx->pegs));
+	idx->count--;
+}
+
 /* Find segment at a given physical extent in a PV */
-static struct pv_segment *find_peg_by_pe(const struct physical_volume *pv,
-					 uint32_t pe)
+static struct pv_segment *find_peg_by_pe(struct dm_pool *mem,
+					 struct physical_volume *pv,
+					 uint32_t pe, int *pos)
 {
 	struct pv_segment *pvseg;
+	uint32_t count = 0;
+
+	if ((*pos = _peg_index_find(pv, pe)) >= 0)
+		return pv->seg_index->pegs[*pos];
 
 	/* search backwards to optimise mostly used last segment split */
+	dm_list_iterate_back_items(pvseg, &pv->segments) {
+		if (pe >= pvseg->pe && pe < pvseg->pe + pvseg->len)
+			return pvseg;
+		if (++count == PEG_INDEX_MIN_SEGMENTS)
+			break;
+	}
+
+	if (count == PEG_INDEX_MIN_SEGMENTS && _peg_index_build(mem, pv) &&
+	    (*pos = _peg_index_find(pv, pe)) >= 0)
+		return pv->seg_index->pegs[*pos];
+
 	dm_list_iterate_back_items(pvseg, &pv->segments)
 		if (pe >= pvseg->pe && pe < pvseg->pe + pvseg->len)
 			return pvseg;
@@ -129,11 +253,12 @@ int pv_split_segment(struct dm_pool *mem,
 		     struct pv_segment **pvseg_allocated)
 {
 	struct pv_segment *pvseg, *pvseg_new = NULL;
+	int pos;
 
 	if (pe == pv->pe_count)
 		goto out;
 
-	if (!(pvseg = find_peg_by_pe(pv, pe))) {
+	if (!(pvseg = find_peg_by_pe(mem, pv, pe, &pos))) {
 		log_error("Segment with extent %" PRIu32 " in PV %s not found",
 			  pe, pv_dev_name(pv));
 		return 0;
@@ -147,6 +272,8 @@ int pv_split_segment(struct dm_pool *mem,
 
 	if (!(pvseg_new = _pv_split_segment(mem, pv, pvseg, pe)))
 		return_0;
+
+	_peg_index_insert(pv, pos, pvseg_new);
 out:
 	if (pvseg_allocated)
 		*pvseg_allocated = pvseg_new;
@@ -252,6 +379,9 @@ int release_pv_segment(struct pv_segment *peg, uint32_t area_reduction)
  */
 void merge_pv_segments(struct pv_segment *peg1, struct pv_segment *peg2)
 {
+	if (peg1->pv->seg_index)
+		_peg_index_remove(peg1->pv, peg2);
+
 	peg1->len += peg2->len;
 
 	dm_list_del(&peg2->list);
@@ -275,6 +405,38 @@ static uint32_t _overlap_pe(const struct pv_segment *pvseg,
 		return end - start;
 }
 
+/*
+ * Returns: number of free PEs of pv within per
+ */
+static uint32_t _pe_range_extents_free(struct physical_volume *pv,
+				       const struct pe_range *per)
+{
+	struct pv_segment *pvseg;
+	uint32_t extents = 0;
+	int pos;
+
+	/* The whole PV: the counters already hold the answer */
+	if (!per->start && per->count >= pv->pe_count)
+		return pv->pe_count - pv->pe_alloc_count;
+
+	if (!pv->vg || per->start >= pv->pe_count ||
+	    !(pvseg = find_peg_by_pe(pv->vg->vgmem, pv, per->start, &pos))) {
+		dm_list_iterate_items(pvseg, &pv->segments)
+			if (!pvseg_is_allocated(pvseg))
+				extents += _overlap_pe(pvseg, per);
+		return extents;
+	}
+
+	/* Only visit the segments overlapping the range */
+	for (; &pvseg->list != &pv->segments &&
+	       pvseg->pe < per->start + per->count;
+	     pvseg = dm_list_item(pvseg->list.n, struct pv_segment))
+		if (!pvseg_is_allocated(pvseg))
+			extents += _overlap_pe(pvseg, per);
+
+	return extents;
+}
+
 /*
  * Returns: number of free PEs in a struct pv_list
  */
@@ -283,16 +445,10 @@ uint32_t pv_list_extents_free(const struct dm_list *pvh)
 	struct pv_list *pvl;
 	struct pe_range *per;
 	uint32_t extents = 0;
-	struct pv_segment *pvseg;
 
-	dm_list_iterate_items(pvl, pvh) {
-		dm_list_iterate_items(per, pvl->pe_ranges) {
-			dm_list_iterate_items(pvseg, &pvl->pv->segments) {
-				if (!pvseg_is_allocated(pvseg))
-					extents += _overlap_pe(pvseg, per);
-			}
-		}
-	}
+	dm_list_iterate_items(pvl, pvh)
+		dm_list_iterate_items(per, pvl->pe_ranges)
+			extents += _pe_range_extents_free(pvl->pv, per);
 
 	return extents;
 }
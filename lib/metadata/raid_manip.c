@@ -1570,28 +1570,37 @@ int lv_raid_reshape(struct logical_volume *lv,
 }
 
 /*
- * lv_raid_replace
- * @lv
- * @replace_pvs
- * @allocatable_pvs
- *
- * Replace the specified PVs.
+ * Per-LV state of a RAID image replacement between its two commits.
  */
-int lv_raid_replace(struct logical_volume *lv,
-		    struct dm_list *remove_pvs,
-		    struct dm_list *allocate_pvs)
+struct raid_replace {
+	struct dm_list list;
+	struct logical_volume *lv;
+	struct dm_list old_meta_lvs;
+	struct dm_list old_data_lvs;
+	char **tmp_names;
+};
+
+/*
+ * Allocate replacements for the images of rr->lv on remove_pvs and put
+ * them in place in memory.  Sets *replace to 0 if nothing has to be done.
+ */
+static int _raid_replace_prepare(struct raid_replace *rr,
+				 struct dm_list *remove_pvs,
+				 struct dm_list *allocate_pvs,
+				 int *replace)
 {
+	struct logical_volume *lv = rr->lv;
 	uint32_t s, sd, match_count = 0;
-	struct dm_list old_meta_lvs, old_data_lvs;
 	struct dm_list new_meta_lvs, new_data_lvs;
 	struct lv_segment *raid_seg = first_seg(lv);
 	struct lv_list *lvl;
-	char *tmp_names[raid_seg->area_count * 2];
+	char **tmp_names;
 
-	dm_list_init(&old_meta_lvs);
-	dm_list_init(&old_data_lvs);
+	dm_list_init(&rr->old_meta_lvs);
+	dm_list_init(&rr->old_data_lvs);
 	dm_list_init(&new_meta_lvs);
 	dm_list_init(&new_data_lvs);
+	*replace = 0;
 
 	/*
 	 * How many sub-LVs are being removed?
@@ -1625,6 +1634,11 @@ int lv_raid_replace(struct logical_volume *lv,
 		return 0;
 	}
 
+	if (!(tmp_names = dm_pool_zalloc(lv->vg->vgmem, 2 * raid_seg->area_count *
+					 sizeof(*tmp_names))))
+		return_0;
+	rr->tmp_names = tmp_names;
+
 	/*
 	 * Allocate the new image components first
 	 * - This makes it easy to avoid all currently used devs
@@ -1665,7 +1679,7 @@ try_again:
 	 */
 	if (!_raid_extract_images(lv, raid_seg->area_count - match_count,
 				  remove_pvs, 0,
-				  &old_meta_lvs, &old_data_lvs)) {
+				  &rr->old_meta_lvs, &rr->old_data_lvs)) {
 		log_error("Failed to remove the specified images from %s/%s",
 			  lv->vg->name, lv->name);
 		return 0;
@@ -1679,9 +1693,7 @@ try_again:
 	 */
 
 	for (s = 0; s < raid_seg->area_count; s++) {
-		tmp_names[s] = NULL;
 		sd = s + raid_seg->area_count;
-		tmp_names[sd] = NULL;
 
 		if ((seg_type(raid_seg, s) == AREA_UNASSIGNED) &&
 		    (seg_metatype(raid_seg, s) == AREA_UNASSIGNED)) {
@@ -1725,37 +1737,70 @@ try_again:
 		}
 	}
 
-	if (!vg_write(lv->vg)) {
-		log_error("Failed to write changes to %s in %s",
-			  lv->name, lv->vg->name);
-		return 0;
-	}
+	*replace = 1;
 
-	if (!suspend_lv_origin(lv->vg->cmd, lv)) {
-		log_error("Failed to suspend %s/%s before committing changes",
-			  lv->vg->name, lv->name);
-		return 0;
-	}
+	return 1;
+}
 
-	if (!vg_commit(lv->vg)) {
-		log_error("Failed to commit changes to %s in %s",
-			  lv->name, lv->vg->name);
+/*
+ * Write and commit the VG once for all LVs on the list, reloading
+ * each of them against the new metadata.
+ */
+static int _raid_replace_commit(struct volume_group *vg, struct dm_list *rrs)
+{
+	struct raid_replace *rr, *rs;
+
+	if (!vg_write(vg)) {
+		log_error("Failed to write changes to %s", vg->name);
 		return 0;
 	}
 
-	if (!resume_lv_origin(lv->vg->cmd, lv)) {
-		log_error("Failed to resume %s/%s after committing changes",
-			  lv->vg->name, lv->name);
+	dm_list_iterate_items(rr, rrs)
+		if (!suspend_lv_origin(vg->cmd, rr->lv)) {
+			log_error("Failed to suspend %s/%s before committing "
+				  "changes", vg->name, rr->lv->name);
+			vg_revert(vg);
+			dm_list_iterate_items(rs, rrs) {
+				if (rs == rr)
+					break;
+				if (!resume_lv_origin(vg->cmd, rs->lv))
+					stack;
+			}
+			return 0;
+		}
+
+	if (!vg_commit(vg)) {
+		log_error("Failed to commit changes to %s", vg->name);
 		return 0;
 	}
 
-	dm_list_iterate_items(lvl, &old_meta_lvs) {
+	dm_list_iterate_items(rr, rrs)
+		if (!resume_lv_origin(vg->cmd, rr->lv)) {
+			log_error("Failed to resume %s/%s after committing "
+				  "changes", vg->name, rr->lv->name);
+			return 0;
+		}
+
+	return 1;
+}
+
+/*
+ * Drop the replaced images and give the new ones their final names.
+ */
+static int _raid_replace_finish(struct raid_replace *rr)
+{
+	struct logical_volume *lv = rr->lv;
+	struct lv_segment *raid_seg = first_seg(lv);
+	struct lv_list *lvl;
+	uint32_t s, sd;
+
+	dm_list_iterate_items(lvl, &rr->old_meta_lvs) {
 		if (!deactivate_lv(lv->vg->cmd, lvl->lv))
 			return_0;
 		if (!lv_remove(lvl->lv))
 			return_0;
 	}
-	dm_list_iterate_items(lvl, &old_data_lvs) {
+	dm_list_iterate_items(lvl, &rr->old_data_lvs) {
 		if (!deactivate_lv(lv->vg->cmd, lvl->lv))
 			return_0;
 		if (!lv_remove(lvl->lv))
@@ -1765,37 +1810,80 @@ try_again:
 	/* Update new sub-LVs to correct name and clear REBUILD flag */
 	for (s = 0; s < raid_seg->area_count; s++) {
 		sd = s + raid_seg->area_count;
-		if (tmp_names[s] && tmp_names[sd]) {
-			seg_metalv(raid_seg, s)->name = tmp_names[s];
-			seg_lv(raid_seg, s)->name = tmp_names[sd];
+		if (rr->tmp_names[s] && rr->tmp_names[sd]) {
+			seg_metalv(raid_seg, s)->name = rr->tmp_names[s];
+			seg_lv(raid_seg, s)->name = rr->tmp_names[sd];
 			seg_metalv(raid_seg, s)->status &= ~LV_REBUILD;
 			seg_lv(raid_seg, s)->status &= ~LV_REBUILD;
 		}
 	}
 
-	if (!vg_write(lv->vg)) {
-		log_error("Failed to write changes to %s in %s",
-			  lv->name, lv->vg->name);
-		return 0;
-	}
+	return 1;
+}
 
-	if (!suspend_lv_origin(lv->vg->cmd, lv)) {
-		log_error("Failed to suspend %s/%s before committing changes",
-			  lv->vg->name, lv->name);
-		return 0;
-	}
+/*
+ * lv_raid_replace_lvs
+ * @vg
+ * @lvs: RAID LVs of @vg (struct lv_list)
+ * @remove_pvs
+ * @allocate_pvs
+ *
+ * Replace the images of all @lvs on @remove_pvs.  The LVs share the two
+ * metadata commits a replacement needs, so repairing several LVs after
+ * a device failure costs no more commits than repairing one.
+ */
+int lv_raid_replace_lvs(struct volume_group *vg, struct dm_list *lvs,
+			struct dm_list *remove_pvs,
+			struct dm_list *allocate_pvs)
+{
+	struct dm_list rrs;
+	struct raid_replace *rr;
+	struct lv_list *lvl;
+	int replace;
 
-	if (!vg_commit(lv->vg)) {
-		log_error("Failed to commit changes to %s in %s",
-			  lv->name, lv->vg->name);
-		return 0;
-	}
+	dm_list_init(&rrs);
 
-	if (!resume_lv_origin(lv->vg->cmd, lv)) {
-		log_error("Failed to resume %s/%s after committing changes",
-			  lv->vg->name, lv->name);
-		return 0;
+	dm_list_iterate_items(lvl, lvs) {
+		if (!(rr = dm_pool_zalloc(vg->vgmem, sizeof(*rr))))
+			return_0;
+		rr->lv = lvl->lv;
+		if (!_raid_replace_prepare(rr, remove_pvs, allocate_pvs,
+					   &replace))
+			return_0;
+		if (replace)
+			dm_list_add(&rrs, &rr->list);
 	}
 
-	return 1;
+	if (dm_list_empty(&rrs))
+		return 1;
+
+	if (!_raid_replace_commit(vg, &rrs))
+		return_0;
+
+	dm_list_iterate_items(rr, &rrs)
+		if (!_raid_replace_finish(rr))
+			return_0;
+
+	return _raid_replace_commit(vg, &rrs);
+}
+
+/*
+ * lv_raid_replace
+ * @lv
+ * @replace_pvs
+ * @allocatable_pvs
+ *
+ * Replace the specified PVs.
+ */
+int lv_raid_replace(struct logical_volume *lv,
+		    struct dm_list *remove_pvs,
+		    struct dm_list *allocate_pvs)
+{
+	struct dm_list lvs;
+	struct lv_list lvl = { .lv = lv };
+
+	dm_list_init(&lvs);
+	dm_list_add(&lvs, &lvl.list);
+
+	return lv_raid_replace_lvs(lv->vg, &lvs, remove_pvs, allocate_pvs);
 }
@@ -27,6 +27,13 @@ struct segment_type *get_segtype_from_string(struct cmd_context *cmd,
 			return segtype;
 	}
 
+	if (cmd->segtype_libraries_pending) {
+		if (!load_segtype_libraries(cmd))
+			return_NULL;
+
+		return get_segtype_from_string(cmd, str);
+	}
+
 	if (!(segtype = init_unknown_segtype(cmd, str)))
 		return_NULL;
 
@@ -98,6 +98,7 @@ void init_snapshot_seg(struct lv_segment *seg, struct logical_volume *origin,
 	cow->snapshot = seg;
 
 	origin->origin_count++;
+	origin->vg->cow_count++;
 
 	/* FIXME Assumes an invisible origin belongs to a sparse device */
 	if (!lv_is_visible(origin))
@@ -179,6 +180,7 @@ int vg_remove_snapshot(struct logical_volume *cow)
 
 	dm_list_del(&cow->snapshot->origin_list);
 	origin->origin_count--;
+	origin->vg->cow_count--;
 
 	if (find_merging_cow(origin) == find_cow(cow)) {
 		clear_snapshot_merge(origin);
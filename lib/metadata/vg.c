@@ -181,14 +181,7 @@ uint64_t vg_max_lv(const struct volume_group *vg)
 
 unsigned snapshot_count(const struct volume_group *vg)
 {
-	struct lv_list *lvl;
-	unsigned num_snapshots = 0;
-
-	dm_list_iterate_items(lvl, &vg->lvs)
-		if (lv_is_cow(lvl->lv))
-			num_snapshots++;
-
-	return num_snapshots;
+	return vg->cow_count;
 }
 
 unsigned vg_visible_lvs(const struct volume_group *vg)
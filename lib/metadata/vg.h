@@ -89,6 +89,7 @@ struct volume_group {
 	 * - one for the user-visible mirror LV
 	 */
 	struct dm_list lvs;
+	uint32_t cow_count;	/* snapshot_count(), kept by init_snapshot_seg() */
 
 	struct dm_list tags;
 
@@ -111,6 +112,7 @@ struct volume_group {
 	uint32_t mda_copies; /* target number of mdas for this VG */
 
 	struct dm_hash_table *hostnames; /* map of creation hostnames */
+	struct dm_hash_table *import_lv_hash; /* LV names while importing */
 };
 
 struct volume_group *alloc_vg(const char *pool_name, struct cmd_context *cmd,
@@ -46,6 +46,8 @@ static int _retry_deactivation = DEFAULT_RETRY_DEACTIVATION;
 static int _activation_checks = 0;
 static char _sysfs_dir_path[PATH_MAX] = "";
 static int _dev_disable_after_error_count = DEFAULT_DISABLE_AFTER_ERROR_COUNT;
+static unsigned _dev_open_fd_cache_size = 0;
+static unsigned _pv_init_parallelism = 1;
 static uint64_t _pv_min_size = (DEFAULT_PV_MIN_SIZE_KB * 1024L >> SECTOR_SHIFT);
 static int _detect_internal_vg_cache_corruption =
 	DEFAULT_DETECT_INTERNAL_VG_CACHE_CORRUPTION;
@@ -153,6 +155,16 @@ void init_dev_disable_after_error_count(int value)
 	_dev_disable_after_error_count = value;
 }
 
+void init_dev_open_fd_cache_size(unsigned size)
+{
+	_dev_open_fd_cache_size = size;
+}
+
+void init_pv_init_parallelism(unsigned processes)
+{
+	_pv_init_parallelism = processes ? processes : 1;
+}
+
 void init_pv_min_size(uint64_t sectors)
 {
 	_pv_min_size = sectors;
@@ -298,6 +310,16 @@ int dev_disable_after_error_count(void)
 	return _dev_disable_after_error_count;
 }
 
+unsigned dev_open_fd_cache_size(void)
+{
+	return _dev_open_fd_cache_size;
+}
+
+unsigned pv_init_parallelism(void)
+{
+	return _pv_init_parallelism;
+}
+
 uint64_t pv_min_size(void)
 {
 	return _pv_min_size;
@@ -40,6 +40,8 @@ void init_error_message_produced(int produced);
 void init_is_static(unsigned value);
 void init_udev_checking(int checking);
 void init_dev_disable_after_error_count(int value);
+void init_dev_open_fd_cache_size(unsigned size);
+void init_pv_init_parallelism(unsigned processes);
 void init_pv_min_size(uint64_t sectors);
 void init_activation_checks(int checks);
 void init_detect_internal_vg_cache_corruption(int detect);
@@ -76,5 +78,7 @@ int dmeventd_monitor_mode(void);
 
 #define NO_DEV_ERROR_COUNT_LIMIT 0
 int dev_disable_after_error_count(void);
+unsigned dev_open_fd_cache_size(void);
+unsigned pv_init_parallelism(void);
 
 #endif
@@ -28,6 +28,9 @@ daemon_handle daemon_open(daemon_info i) {
 	daemon_reply r = { .cft = NULL };
 	struct sockaddr_un sockaddr;
 
+	if (!(h.in = dm_zalloc(sizeof(*h.in))))
+		goto error;
+
 	if ((h.socket_fd = socket(PF_UNIX, SOCK_STREAM /* | SOCK_NONBLOCK */, 0)) < 0)
 		goto error;
 
@@ -64,13 +67,17 @@ error:
 			perror("close");
 	if (r.cft)
 		daemon_reply_destroy(r);
+	if (h.in) {
+		free(h.in->mem);
+		dm_free(h.in);
+		h.in = NULL;
+	}
 	h.socket_fd = -1;
 	return h;
 }
 
-daemon_reply daemon_send(daemon_handle h, daemon_request rq)
+int daemon_write_request(daemon_handle h, daemon_request rq)
 {
-	daemon_reply reply = { .cft = NULL, .error = 0 };
 	assert(h.socket_fd >= 0);
 
 	if (!rq.buffer) {
@@ -78,17 +85,43 @@ daemon_reply daemon_send(daemon_handle h, daemon_request rq)
 	}
 
 	assert(rq.buffer);
-	if (!write_buffer(h.socket_fd, rq.buffer, strlen(rq.buffer)))
-		reply.error = errno;
+	return write_buffer(h.socket_fd, rq.buffer, strlen(rq.buffer));
+}
+
+daemon_reply daemon_read_reply(daemon_handle h)
+{
+	daemon_reply reply = { .cft = NULL, .error = 0, .buffer = NULL };
+	char *message;
 
-	if (read_buffer(h.socket_fd, &reply.buffer)) {
-		reply.cft = dm_config_from_string(reply.buffer);
-	} else
+	assert(h.socket_fd >= 0 && h.in);
+
+	if (!read_buffer_into(h.socket_fd, h.in, &message)) {
 		reply.error = errno;
+		return reply;
+	}
+
+	if (!(reply.buffer = dm_strdup(message))) {
+		reply.error = ENOMEM;
+		return reply;
+	}
+
+	reply.cft = dm_config_from_string(reply.buffer);
 
 	return reply;
 }
 
+daemon_reply daemon_send(daemon_handle h, daemon_request rq)
+{
+	daemon_reply reply = { .cft = NULL, .error = 0, .buffer = NULL };
+
+	if (!daemon_write_request(h, rq)) {
+		reply.error = errno;
+		return reply;
+	}
+
+	return daemon_read_reply(h);
+}
+
 void daemon_reply_destroy(daemon_reply r) {
 	if (r.cft)
 		dm_config_destroy(r.cft);
@@ -115,7 +148,32 @@ daemon_reply daemon_send_simple(daemon_handle h, const char *id, ...)
 	return repl;
 }
 
+int daemon_write_simple(daemon_handle h, const char *id, ...)
+{
+	daemon_request rq = { .cft = NULL };
+	va_list ap;
+	int r;
+
+	va_start(ap, id);
+	rq.buffer = format_buffer("request", id, ap);
+	va_end(ap);
+
+	if (!rq.buffer) {
+		errno = ENOMEM;
+		return 0;
+	}
+
+	r = daemon_write_request(h, rq);
+	dm_free(rq.buffer);
+
+	return r;
+}
+
 void daemon_close(daemon_handle h)
 {
+	if (h.in) {
+		free(h.in->mem);
+		dm_free(h.in);
+	}
 	dm_free((char *)h.protocol);
 }
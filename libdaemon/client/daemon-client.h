@@ -17,11 +17,14 @@
 
 #include "libdevmapper.h"
 
+struct message_buffer;
+
 typedef struct {
 	int socket_fd; /* the fd we use to talk to the daemon */
 	const char *protocol;
 	int protocol_version;  /* version of the protocol the daemon uses */
 	int error;
+	struct message_buffer *in; /* replies not yet collected */
 } daemon_handle;
 
 typedef struct {
@@ -88,6 +91,21 @@ daemon_reply daemon_send(daemon_handle h, daemon_request r);
  */
 daemon_reply daemon_send_simple(daemon_handle h, const char *id, ...);
 
+/*
+ * The two halves of daemon_send, for pipelining: any number of requests may be
+ * written before their replies are collected. The daemon answers requests on
+ * one connection in the order they were sent, so daemon_read_reply returns the
+ * replies in that same order. Since the daemon stops reading while a reply it
+ * is writing does not fit into the socket, only a bounded number of requests
+ * should be outstanding at any time. Return 0 and set errno on failure.
+ *
+ * daemon_read_reply also reads messages on connections where the daemon talks
+ * unprompted (such as an lvmetad subscription).
+ */
+int daemon_write_request(daemon_handle h, daemon_request r);
+int daemon_write_simple(daemon_handle h, const char *id, ...);
+daemon_reply daemon_read_reply(daemon_handle h);
+
 void daemon_reply_destroy(daemon_reply r);
 
 static inline int64_t daemon_reply_int(daemon_reply r, const char *path, int64_t def) {
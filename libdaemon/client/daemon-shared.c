@@ -22,50 +22,90 @@
 #include "daemon-shared.h"
 #include "libdevmapper.h"
 
+/* Find the "\n##\n" message terminator in mem[from, used). */
+static char *_find_terminator(char *mem, int from, int used)
+{
+	char *p = mem + from, *end = mem + used;
+
+	while (end - p >= 4 && (p = memchr(p, '\n', end - p - 3))) {
+		if (!strncmp(p, "\n##\n", 4))
+			return p;
+		p++;
+	}
+
+	return NULL;
+}
+
 /*
  * Read a single message from a (socket) filedescriptor. Messages are delimited
- * by blank lines. This call will block until all of a message is received. The
- * memory will be allocated from heap. Upon error, all memory is freed and the
- * buffer pointer is set to NULL.
+ * by blank lines. This call will block until all of a message is received.
  *
- * See also write_buffer about blocking (read_buffer has identical behaviour).
+ * *message points into the buffer and stays valid until the next call with
+ * the same buffer, which is reused and grown as needed. The buffer is left
+ * for the caller to free even when the read fails.
  */
-int read_buffer(int fd, char **buffer) {
-	int bytes = 0;
-	int buffersize = 32;
-	char *new;
-	*buffer = malloc(buffersize + 1);
+int read_buffer_into(int fd, struct message_buffer *b, char **message) {
+	int result;
+	int from = 0;
+	char *new, *end;
+
+	if (b->consumed) {
+		b->used -= b->consumed;
+		memmove(b->mem, b->mem + b->consumed, b->used);
+		b->consumed = 0;
+	}
 
 	while (1) {
-		int result = read(fd, (*buffer) + bytes, buffersize - bytes);
+		if ((end = _find_terminator(b->mem, from, b->used))) {
+			*end = 0;
+			b->consumed = end - b->mem + 4;
+			*message = b->mem;
+			return 1; /* success, we have the full message now */
+		}
+
+		from = (b->used > 3) ? b->used - 3 : 0;
+
+		if (b->used == b->size) {
+			if (!(new = realloc(b->mem, (b->size ? b->size * 2 : 1024) + 1)))
+				return 0;
+
+			b->mem = new;
+			b->size = b->size ? b->size * 2 : 1024;
+		}
+
+		result = read(fd, b->mem + b->used, b->size - b->used);
 		if (result > 0)
-			bytes += result;
+			b->used += result;
 		if (result == 0) {
 			errno = ECONNRESET;
-			goto fail; /* we should never encounter EOF here */
+			return 0; /* we should never encounter EOF here */
 		}
 		if (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
-			goto fail;
-
-		if (!strncmp((*buffer) + bytes - 4, "\n##\n", 4)) {
-			*(*buffer + bytes - 4) = 0;
-			break; /* success, we have the full message now */
-		}
+			return 0;
+		/* TODO call select here if we encountered EAGAIN/EWOULDBLOCK */
+	}
+}
 
-		if (bytes == buffersize) {
-			buffersize += 1024;
-			if (!(new = realloc(*buffer, buffersize + 1)))
-				goto fail;
+/*
+ * Read a single message into a newly allocated buffer. Upon error, all memory
+ * is freed and the buffer pointer is set to NULL. Must not be mixed with
+ * read_buffer_into on the same descriptor, since anything read past the end
+ * of the message is lost.
+ *
+ * See also write_buffer about blocking (read_buffer has identical behaviour).
+ */
+int read_buffer(int fd, char **buffer) {
+	struct message_buffer b = { .mem = NULL };
+	char *message;
 
-			*buffer = new;
-		}
-		/* TODO call select here if we encountered EAGAIN/EWOULDBLOCK */
+	*buffer = NULL;
+	if (!read_buffer_into(fd, &b, &message)) {
+		free(b.mem);
+		return 0;
 	}
+
+	*buffer = b.mem;
 	return 1;
-fail:
-	free(*buffer);
-	*buffer = NULL;
-	return 0;
 }
 
 /*
@@ -100,42 +140,78 @@ write:
 	goto write;
 }
 
+struct format {
+	char *buffer;
+	int size;
+	int used;
+};
+
+/* Append to the buffer being formatted, growing it as needed. */
+__attribute__ ((format(printf, 2, 3)))
+static int _format_append(struct format *f, const char *fmt, ...)
+{
+	va_list ap;
+	char *new;
+	int n;
+
+	while (1) {
+		va_start(ap, fmt);
+		n = vsnprintf(f->buffer + f->used, f->size - f->used, fmt, ap);
+		va_end(ap);
+
+		if (n < 0)
+			return 0;
+
+		if (n < f->size - f->used) {
+			f->used += n;
+			return 1;
+		}
+
+		while (f->size - f->used <= n)
+			f->size *= 2;
+
+		if (!(new = dm_realloc(f->buffer, f->size)))
+			return 0;
+
+		f->buffer = new;
+	}
+}
+
 char *format_buffer(const char *what, const char *id, va_list ap)
 {
-	char *buffer, *old;
+	struct format f = { .size = 256, .used = 0 };
 	char *next;
 	int keylen;
 
-	dm_asprintf(&buffer, "%s = \"%s\"\n", what, id);
-	if (!buffer) goto fail;
+	if (!(f.buffer = dm_malloc(f.size)))
+		return NULL;
+
+	if (!_format_append(&f, "%s = \"%s\"\n", what, id))
+		goto fail;
 
 	while ((next = va_arg(ap, char *))) {
-		old = buffer;
 		assert(strchr(next, '='));
 		keylen = strchr(next, '=') - next;
 		if (strstr(next, "%d")) {
 			int value = va_arg(ap, int);
-			dm_asprintf(&buffer, "%s%.*s= %d\n", buffer, keylen, next, value);
-			dm_free(old);
+			if (!_format_append(&f, "%.*s= %d\n", keylen, next, value))
+				goto fail;
 		} else if (strstr(next, "%s")) {
 			char *value = va_arg(ap, char *);
-			dm_asprintf(&buffer, "%s%.*s= \"%s\"\n", buffer, keylen, next, value);
-			dm_free(old);
+			if (!_format_append(&f, "%.*s= \"%s\"\n", keylen, next, value))
+				goto fail;
 		} else if (strstr(next, "%b")) {
 			char *block = va_arg(ap, char *);
 			if (!block)
 				continue;
-			dm_asprintf(&buffer, "%s%.*s%s", buffer, keylen, next, block);
-			dm_free(old);
-		} else {
-			dm_asprintf(&buffer, "%s%s", buffer, next);
-			dm_free(old);
-		}
-		if (!buffer) goto fail;
+			if (!_format_append(&f, "%.*s%s", keylen, next, block))
+				goto fail;
+		} else if (!_format_append(&f, "%s", next))
+			goto fail;
 	}
 
-	return buffer;
+	return f.buffer;
 fail:
-	dm_free(buffer);
+	dm_free(f.buffer);
 	return NULL;
 }
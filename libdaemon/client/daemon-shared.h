@@ -23,7 +23,21 @@
 
 #include <stdarg.h>
 
+/*
+ * Messages arriving on a socket. When requests or replies are pipelined, one
+ * read may return the end of one message together with the start of the
+ * next, so whatever follows the last returned message is kept here for the
+ * next call to read_buffer_into.
+ */
+struct message_buffer {
+	char *mem;
+	int size;	/* allocated, not counting room for the terminating NUL */
+	int used;	/* bytes held */
+	int consumed;	/* bytes at the start used up by the last message */
+};
+
 int read_buffer(int fd, char **buffer);
+int read_buffer_into(int fd, struct message_buffer *b, char **message);
 int write_buffer(int fd, const char *buffer, int length);
 char *format_buffer(const char *what, const char *id, va_list ap);
 
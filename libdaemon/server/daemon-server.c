@@ -341,30 +341,46 @@ response daemon_reply_simple(const char *id, ...)
 	return res;
 }
 
+/*
+ * Per-connection state. The request tree and both buffers live as long as the
+ * connection, so serving a request does not need to allocate once they have
+ * grown to the size of the typical message.
+ */
 struct thread_baton {
 	daemon_state s;
 	client_handle client;
+	struct message_buffer in;	/* requests, possibly pipelined */
+	struct dm_config_tree *cft;	/* every request is parsed into this */
+	char *out;			/* response being formatted */
+	size_t out_size;
+	size_t out_used;
 };
 
-static int buffer_rewrite(char **buf, const char *format, const char *string) {
-	char *old = *buf;
-	int r = dm_asprintf(buf, format, *buf, string);
+static int buffer_append(struct thread_baton *b, const char *data, size_t len) {
+	size_t new_size = b->out_size ? : 1024;
+	char *new;
+
+	while (new_size < b->out_used + len + 1)
+		new_size *= 2;
+
+	if (new_size != b->out_size) {
+		if (!(new = realloc(b->out, new_size)))
+			return 0;
+		b->out = new;
+		b->out_size = new_size;
+	}
 
-	dm_free(old);
+	memcpy(b->out + b->out_used, data, len);
+	b->out_used += len;
+	b->out[b->out_used] = 0;
 
-	return (r < 0) ? 0 : 1;
+	return 1;
 }
 
 static int buffer_line(const char *line, void *baton) {
-	response *r = baton;
-
-	if (r->buffer) {
-		if (!buffer_rewrite(&r->buffer, "%s\n%s", line))
-			return 0;
-	} else if (dm_asprintf(&r->buffer, "%s\n", line) < 0)
-		return 0;
+	struct thread_baton *b = baton;
 
-	return 1;
+	return buffer_append(b, line, strlen(line)) && buffer_append(b, "\n", 1);
 }
 
 static response builtin_handler(daemon_state s, client_handle h, request r)
@@ -385,14 +401,24 @@ static void *client_thread(void *baton)
 	struct thread_baton *b = baton;
 	request req;
 	response res;
+	void *mark;
+
+	if (!(b->cft = dm_config_create()))
+		goto fail;
 
 	while (1) {
-		if (!read_buffer(b->client.socket_fd, &req.buffer))
+		if (!read_buffer_into(b->client.socket_fd, &b->in, &req.buffer))
+			goto fail;
+
+		/* Everything the request parse allocates goes in one go after the reply. */
+		if (!(mark = dm_pool_alloc(b->cft->mem, 1)))
 			goto fail;
 
-		req.cft = dm_config_from_string(req.buffer);
-		if (!req.cft)
+		req.cft = b->cft;
+		if (!dm_config_parse(req.cft, req.buffer, req.buffer + strlen(req.buffer))) {
 			fprintf(stderr, "error parsing request:\n %s\n", req.buffer);
+			req.cft = NULL;
+		}
 
 		res = builtin_handler(b->s, b->client, req);
 
@@ -400,24 +426,32 @@ static void *client_thread(void *baton)
 			res = b->s.handler(b->s, b->client, req);
 
 		if (!res.buffer) {
-			dm_config_write_node(res.cft->root, buffer_line, &res);
-			if (!buffer_rewrite(&res.buffer, "%s\n\n", NULL))
+			b->out_used = 0;
+			if (!dm_config_write_node(res.cft->root, buffer_line, b) ||
+			    !buffer_append(b, "\n", 1))
 				goto fail;
 			dm_config_destroy(res.cft);
+			write_buffer(b->client.socket_fd, b->out, b->out_used);
+		} else {
+			write_buffer(b->client.socket_fd, res.buffer, strlen(res.buffer));
+			free(res.buffer);
 		}
 
-		if (req.cft)
-			dm_config_destroy(req.cft);
-		dm_free(req.buffer);
-
-		write_buffer(b->client.socket_fd, res.buffer, strlen(res.buffer));
-
-		free(res.buffer);
+		/*
+		 * Handlers may put request strings straight into the reply,
+		 * so the request is only released once the reply is out.
+		 */
+		b->cft->root = NULL;
+		dm_pool_free(b->cft->mem, mark);
 	}
 fail:
 	/* TODO what should we really do here? */
 	if (close(b->client.socket_fd))
 		perror("close");
+	if (b->cft)
+		dm_config_destroy(b->cft);
+	free(b->in.mem);
+	free(b->out);
 	free(baton);
 	return NULL;
 }
@@ -436,6 +470,8 @@ static int handle_connect(daemon_state s)
 	if (!(baton = malloc(sizeof(struct thread_baton))))
 		return 0;
 
+	memset(baton, 0, sizeof(*baton));
+
 	baton->s = s;
 	baton->client = client;
 
@@ -1297,6 +1297,17 @@ struct dm_regex *dm_regex_create(struct dm_pool *mem, const char * const *patter
  */
 int dm_regex_match(struct dm_regex *regex, const char *s);
 
+/*
+ * Save a compiled matcher into a buffer allocated from mem, returning its
+ * size in *size.  dm_regex_import() recreates the matcher from the buffer
+ * without compiling the patterns again; num_patterns must match those the
+ * exported matcher was created from.  The buffer is in native byte order.
+ * dm_regex_import() returns NULL if the buffer is not a valid export.
+ */
+void *dm_regex_export(struct dm_regex *regex, struct dm_pool *mem, size_t *size);
+struct dm_regex *dm_regex_import(struct dm_pool *mem, unsigned num_patterns,
+				 const void *data, size_t size);
+
 /*
  * This is useful for regression testing only.  The idea is if two
  * fingerprints are different, then the two dfas are certainly not
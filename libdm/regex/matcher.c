@@ -98,27 +98,28 @@ static void _fill_table(struct dm_regex *m, struct rx_node *rx)
                 m->charsets[m->charsets_entered++] = rx;
 }
 
-static int _create_bitsets(struct dm_regex *m)
+static dm_bitset_t _union_bitsets(struct dm_regex *m, dm_bitset_t bs1, dm_bitset_t bs2)
 {
-	unsigned i;
-	struct rx_node *n;
+	dm_bitset_t bs;
 
-	for (i = 0; i < m->num_nodes; i++) {
-		n = m->nodes[i];
-		if (!(n->firstpos = dm_bitset_create(m->scratch, m->num_charsets)))
-			return_0;
-		if (!(n->lastpos = dm_bitset_create(m->scratch, m->num_charsets)))
-			return_0;
-		if (!(n->followpos = dm_bitset_create(m->scratch, m->num_charsets)))
-			return_0;
-	}
+	if (!(bs = dm_bitset_create(m->scratch, m->num_charsets)))
+		return_NULL;
 
-	return 1;
+	dm_bit_union(bs, bs1, bs2);
+
+	return bs;
 }
 
-static void _calc_functions(struct dm_regex *m)
+/*
+ * Only CHARSET nodes need a followpos.  firstpos and lastpos are never
+ * changed once calculated, so a node whose set is just that of a child
+ * shares the child's bitset rather than copying it: with long lists of
+ * patterns the bitsets are wide and most nodes are simple CATs.
+ */
+static int _calc_functions(struct dm_regex *m)
 {
-	unsigned i, j, final = 1;
+	unsigned i, final = 1;
+	int j;
 	struct rx_node *rx, *c1, *c2;
 
 	for (i = 0; i < m->num_nodes; i++) {
@@ -131,48 +132,51 @@ static void _calc_functions(struct dm_regex *m)
 
 		switch (rx->type) {
 		case CAT:
-			if (c1->nullable)
-				dm_bit_union(rx->firstpos,
-					  c1->firstpos, c2->firstpos);
-			else
-				dm_bit_copy(rx->firstpos, c1->firstpos);
-
-			if (c2->nullable)
-				dm_bit_union(rx->lastpos,
-					  c1->lastpos, c2->lastpos);
-			else
-				dm_bit_copy(rx->lastpos, c2->lastpos);
+			if (!c1->nullable)
+				rx->firstpos = c1->firstpos;
+			else if (!(rx->firstpos = _union_bitsets(m, c1->firstpos, c2->firstpos)))
+				return_0;
+
+			if (!c2->nullable)
+				rx->lastpos = c2->lastpos;
+			else if (!(rx->lastpos = _union_bitsets(m, c1->lastpos, c2->lastpos)))
+				return_0;
 
 			rx->nullable = c1->nullable && c2->nullable;
 			break;
 
 		case PLUS:
-			dm_bit_copy(rx->firstpos, c1->firstpos);
-			dm_bit_copy(rx->lastpos, c1->lastpos);
+			rx->firstpos = c1->firstpos;
+			rx->lastpos = c1->lastpos;
 			rx->nullable = c1->nullable;
 			break;
 
 		case OR:
-			dm_bit_union(rx->firstpos, c1->firstpos, c2->firstpos);
-			dm_bit_union(rx->lastpos, c1->lastpos, c2->lastpos);
+			if (!(rx->firstpos = _union_bitsets(m, c1->firstpos, c2->firstpos)) ||
+			    !(rx->lastpos = _union_bitsets(m, c1->lastpos, c2->lastpos)))
+				return_0;
 			rx->nullable = c1->nullable || c2->nullable;
 			break;
 
 		case QUEST:
 		case STAR:
-			dm_bit_copy(rx->firstpos, c1->firstpos);
-			dm_bit_copy(rx->lastpos, c1->lastpos);
+			rx->firstpos = c1->firstpos;
+			rx->lastpos = c1->lastpos;
 			rx->nullable = 1;
 			break;
 
 		case CHARSET:
+			if (!(rx->firstpos = dm_bitset_create(m->scratch, m->num_charsets)) ||
+			    !(rx->followpos = dm_bitset_create(m->scratch, m->num_charsets)))
+				return_0;
 			dm_bit_set(rx->firstpos, rx->charset_index);
-			dm_bit_set(rx->lastpos, rx->charset_index);
+			rx->lastpos = rx->firstpos;
 			rx->nullable = 0;
 			break;
 
 		default:
 			log_error(INTERNAL_ERROR "Unknown calc node type");
+			return 0;
 		}
 
 		/*
@@ -182,25 +186,27 @@ static void _calc_functions(struct dm_regex *m)
 		 */
 		switch (rx->type) {
 		case CAT:
-			for (j = 0; j < m->num_charsets; j++) {
-                                struct rx_node *n = m->charsets[j];
-				if (dm_bit(c1->lastpos, j))
-					dm_bit_union(n->followpos,
-                                                     n->followpos, c2->firstpos);
+			for (j = dm_bit_get_first(c1->lastpos); j >= 0;
+			     j = dm_bit_get_next(c1->lastpos, j)) {
+				struct rx_node *n = m->charsets[j];
+				dm_bit_union(n->followpos,
+					     n->followpos, c2->firstpos);
 			}
 			break;
 
 		case PLUS:
 		case STAR:
-			for (j = 0; j < m->num_charsets; j++) {
-                                struct rx_node *n = m->charsets[j];
-				if (dm_bit(rx->lastpos, j))
-					dm_bit_union(n->followpos,
-                                                     n->followpos, rx->firstpos);
+			for (j = dm_bit_get_first(rx->lastpos); j >= 0;
+			     j = dm_bit_get_next(rx->lastpos, j)) {
+				struct rx_node *n = m->charsets[j];
+				dm_bit_union(n->followpos,
+					     n->followpos, rx->firstpos);
 			}
 			break;
 		}
 	}
+
+	return 1;
 }
 
 static struct dfa_state *_create_dfa_state(struct dm_pool *mem)
@@ -263,7 +269,7 @@ static int _calc_state(struct dm_regex *m, struct dfa_state *dfa, int a)
 	return 1;
 }
 
-static int _calc_states(struct dm_regex *m, struct rx_node *rx)
+static int _calc_states(struct dm_regex *m, dm_bitset_t firstpos)
 {
 	unsigned iwidth = (m->num_charsets / DM_BITS_PER_INT) + 1;
 	struct dfa_state *dfa;
@@ -282,24 +288,22 @@ static int _calc_states(struct dm_regex *m, struct rx_node *rx)
 		if (!(m->charmap[a] = dm_bitset_create(m->scratch, m->num_charsets)))
 			return_0;
 
-        for (i = 0; i < m->num_nodes; i++) {
-		n = m->nodes[i];
-                        if (n->type == CHARSET) {
-                        for (a = dm_bit_get_first(n->charset);
-                             a >= 0; a = dm_bit_get_next(n->charset, a))
-                                dm_bit_set(m->charmap[a], n->charset_index);
-                }
-        }
+	for (i = 0; i < m->num_charsets; i++) {
+		n = m->charsets[i];
+		for (a = dm_bit_get_first(n->charset);
+		     a >= 0; a = dm_bit_get_next(n->charset, a))
+			dm_bit_set(m->charmap[a], n->charset_index);
+	}
 
 	/* create first state */
 	if (!(dfa = _create_dfa_state(m->mem)))
 		return_0;
 
 	m->start = dfa;
-	ttree_insert(m->tt, rx->firstpos + 1, dfa);
+	ttree_insert(m->tt, firstpos + 1, dfa);
 
 	/* prime the queue */
-	if (!(m->h = m->t = _create_state_queue(m->scratch, dfa, rx->firstpos)))
+	if (!(m->h = m->t = _create_state_queue(m->scratch, dfa, firstpos)))
 		return_0;
 
 	if (!(m->dfa_copy = dm_bitset_create(m->scratch, m->num_charsets)))
@@ -379,12 +383,10 @@ struct dm_regex *dm_regex_create(struct dm_pool *mem, const char * const *patter
 
 	_fill_table(m, rx);
 
-	if (!_create_bitsets(m))
+	if (!_calc_functions(m))
 		goto_bad;
 
-	_calc_functions(m);
-
-	if (!_calc_states(m, rx))
+	if (!_calc_states(m, rx->firstpos))
 		goto_bad;
 
 	return m;
@@ -438,6 +440,168 @@ int dm_regex_match(struct dm_regex *regex, const char *s)
 	return r - 1;
 }
 
+/*
+ * A compiled matcher is exported as an array of uint32_t in native byte
+ * order: the magic, the number of charsets and the start set, followed by
+ * each charset's final, its 256 character bits and its followpos set.
+ * Sets of charsets are written as a count followed by the indices, since
+ * they are wide but have few members.  DFA states are not exported: they
+ * get built on demand as before.
+ */
+#define REGEX_EXPORT_MAGIC 0x52474531
+#define CHARSET_WORDS (256 / DM_BITS_PER_INT)
+
+static size_t _set_words(dm_bitset_t bs)
+{
+	size_t r = 1;
+	int i;
+
+	for (i = dm_bit_get_first(bs); i >= 0; i = dm_bit_get_next(bs, i))
+		r++;
+
+	return r;
+}
+
+static uint32_t *_export_set(uint32_t *p, dm_bitset_t bs)
+{
+	uint32_t *count = p++;
+	int i;
+
+	*count = 0;
+	for (i = dm_bit_get_first(bs); i >= 0; i = dm_bit_get_next(bs, i)) {
+		*p++ = i;
+		(*count)++;
+	}
+
+	return p;
+}
+
+void *dm_regex_export(struct dm_regex *regex, struct dm_pool *mem, size_t *size)
+{
+	size_t words = 2 + _set_words(regex->start->bits);
+	uint32_t *buf, *p;
+	struct rx_node *n;
+	unsigned i;
+
+	for (i = 0; i < regex->num_charsets; i++)
+		words += 1 + CHARSET_WORDS + _set_words(regex->charsets[i]->followpos);
+
+	if (!(buf = p = dm_pool_alloc(mem, words * sizeof(*buf))))
+		return_NULL;
+
+	*p++ = REGEX_EXPORT_MAGIC;
+	*p++ = regex->num_charsets;
+	p = _export_set(p, regex->start->bits);
+
+	for (i = 0; i < regex->num_charsets; i++) {
+		n = regex->charsets[i];
+		*p++ = n->final;
+		memcpy(p, n->charset + 1, CHARSET_WORDS * sizeof(*p));
+		p += CHARSET_WORDS;
+		p = _export_set(p, n->followpos);
+	}
+
+	*size = words * sizeof(*buf);
+
+	return buf;
+}
+
+static dm_bitset_t _import_set(struct dm_regex *m, const uint32_t **p,
+			       const uint32_t *end)
+{
+	const uint32_t *q = *p;
+	dm_bitset_t bs;
+	uint32_t count;
+
+	if (q == end)
+		return NULL;
+
+	count = *q++;
+	if (count > (uint32_t) (end - q))
+		return NULL;
+
+	if (!(bs = dm_bitset_create(m->mem, m->num_charsets)))
+		return_NULL;
+
+	while (count--) {
+		if (*q >= m->num_charsets)
+			return NULL;
+		dm_bit_set(bs, *q);
+		q++;
+	}
+
+	*p = q;
+
+	return bs;
+}
+
+struct dm_regex *dm_regex_import(struct dm_pool *mem, unsigned num_patterns,
+				 const void *data, size_t size)
+{
+	const uint32_t *p = data, *end = p + size / sizeof(*p);
+	struct dm_regex *m;
+	struct rx_node *nodes, *n;
+	dm_bitset_t start;
+	unsigned i, final = 1;
+
+	if ((size % sizeof(*p)) || (end - p < 2) || (p[0] != REGEX_EXPORT_MAGIC) ||
+	    (p[1] > (size_t) (end - p) / (2 + CHARSET_WORDS))) {
+		log_debug("Invalid exported regex matcher.");
+		return NULL;
+	}
+
+	if (!(m = dm_pool_zalloc(mem, sizeof(*m))))
+		return_NULL;
+
+	m->mem = m->scratch = mem;
+	m->num_charsets = p[1];
+	p += 2;
+
+	if (!(nodes = dm_pool_zalloc(mem, sizeof(*nodes) * m->num_charsets)) ||
+	    !(m->charsets = dm_pool_alloc(mem, sizeof(*m->charsets) * m->num_charsets)))
+		goto_bad;
+
+	if (!(start = _import_set(m, &p, end)))
+		goto invalid;
+
+	for (i = 0; i < m->num_charsets; i++) {
+		n = m->charsets[i] = nodes + i;
+		n->type = CHARSET;
+		n->charset_index = i;
+
+		if (end - p < 1 + CHARSET_WORDS)
+			goto invalid;
+
+		n->final = *p++;
+		if (!(n->charset = dm_bitset_create(mem, 256)))
+			goto_bad;
+		memcpy(n->charset + 1, p, CHARSET_WORDS * sizeof(*p));
+		p += CHARSET_WORDS;
+
+		/* Finals number the patterns, as _calc_functions does. */
+		if (n->final != (dm_bit(n->charset, TARGET_TRANS) ? (int) final++ : 0))
+			goto invalid;
+
+		if (!(n->followpos = _import_set(m, &p, end)))
+			goto invalid;
+	}
+
+	if ((p != end) || (final != num_patterns + 1))
+		goto invalid;
+
+	if (!_calc_states(m, start))
+		goto_bad;
+
+	return m;
+
+invalid:
+	log_debug("Invalid exported regex matcher.");
+bad:
+	dm_pool_free(mem, m);
+
+	return NULL;
+}
+
 /*
  * The next block of code concerns calculating a fingerprint for the dfa.
  *
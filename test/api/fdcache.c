@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2012 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#undef NDEBUG
+
+#include "lvm2app.h"
+#include "assert.h"
+
+#include <dirent.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+/* Count descriptors of this process that refer to block device 'rdev' */
+static int _open_fds(dev_t rdev)
+{
+	DIR *d;
+	struct dirent *de;
+	struct stat st;
+	char path[PATH_MAX];
+	int count = 0;
+
+	d = opendir("/proc/self/fd");
+	assert(d);
+
+	while ((de = readdir(d))) {
+		if (de->d_name[0] == '.')
+			continue;
+		snprintf(path, sizeof(path), "/proc/self/fd/%s", de->d_name);
+		if (!stat(path, &st) && S_ISBLK(st.st_mode) && st.st_rdev == rdev)
+			count++;
+	}
+
+	closedir(d);
+
+	return count;
+}
+
+int main(int argc, char *argv[])
+{
+	lvm_t handle;
+	vg_t vg;
+	struct dm_list *vgnames;
+	struct stat st;
+
+	assert(argc == 3);
+	assert(!stat(argv[2], &st) && S_ISBLK(st.st_mode));
+
+	handle = lvm_init(NULL);
+	assert(handle);
+
+	/* Library calls must not leave the PV open behind them. */
+	assert(!lvm_scan(handle));
+	assert(_open_fds(st.st_rdev) == 0);
+
+	vgnames = lvm_list_vg_names(handle);
+	assert(vgnames && !dm_list_empty(vgnames));
+	assert(_open_fds(st.st_rdev) == 0);
+
+	vg = lvm_vg_open(handle, argv[1], "r", 0);
+	assert(vg);
+	lvm_vg_close(vg);
+	assert(_open_fds(st.st_rdev) == 0);
+
+	lvm_quit(handle);
+	return 0;
+}
@@ -0,0 +1,38 @@
+#!/bin/sh
+# Copyright (C) 2012 Red Hat, Inc. All rights reserved.
+#
+# This file is part of LVM2.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+
+. lib/test
+
+# Device-mapper devices are never kept open, so use the loop device itself.
+aux prepare_loop 8
+loop=$(basename "$(cat LOOP)")
+dev="$DM_DEV_DIR/$loop"
+test -b "$dev" || skip
+aux lvmconf "devices/filter = [ \"a|/$loop\$|\", \"r|.*|\" ]" \
+	    "devices/open_fd_cache_size = 4"
+
+pvcreate "$dev"
+vgcreate -c n $vg "$dev"
+
+# Commands reuse the cached descriptor and close it before returning.
+pvs -vvvv 2> err
+grep "opens reused a cached descriptor" err
+sed -n '/opens reused a cached descriptor/,/Completed: pvs/p' err | grep "Closed .*/$loop$"
+
+pvs -vvvv --config 'devices { open_fd_cache_size = 0 }' 2> err
+not grep "reused a cached descriptor" err
+
+# Library users never keep unreferenced devices open.
+aux apitest fdcache $vg "$dev"
+
+vgremove -ff $vg
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2012 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#undef NDEBUG
+
+#include "configure.h"
+#include "lvmetad-client.h"
+#include "assert.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * lvmetad-notify.t watch
+ *	Print every notification on a line of its own, e.g.
+ *	"vg_update vgid=... name=vg seqno=2", until lvmetad goes away.
+ * lvmetad-notify.t overflow
+ *	Check a subscriber that stops reading is told it lost notifications
+ *	and gets the ones that follow.
+ */
+
+/*
+ * Long ids fill the subscriber queue with few requests: about 2300 of them
+ * take the 1MiB lvmetad allows plus what the socket buffers.
+ */
+#define PVID_LEN 400
+#define FLOOD_REQUESTS 5000
+
+static daemon_handle _open(void)
+{
+	daemon_handle h = lvmetad_open(getenv("LVM_LVMETAD_SOCKET"));
+
+	assert(h.socket_fd >= 0 && !h.error);
+
+	return h;
+}
+
+static daemon_handle _subscribe(void)
+{
+	daemon_handle h = _open();
+	daemon_reply reply = lvmetad_subscribe(h);
+
+	assert(!reply.error && reply.cft);
+	assert(!strcmp(daemon_reply_str(reply, "response", ""), "OK"));
+	daemon_reply_destroy(reply);
+
+	return h;
+}
+
+/* Returns the notification name, or NULL once the connection is gone. */
+static const char *_read_notification(daemon_handle h, daemon_reply *reply)
+{
+	*reply = daemon_read_reply(h);
+	if (reply->error || !reply->cft)
+		return NULL;
+
+	return daemon_reply_str(*reply, "notification", "");
+}
+
+static void _print(daemon_reply reply)
+{
+	const struct dm_config_node *cn;
+
+	printf("%s", daemon_reply_str(reply, "notification", ""));
+
+	for (cn = reply.cft->root; cn; cn = cn->sib) {
+		if (!cn->v || !strcmp(cn->key, "notification"))
+			continue;
+		if (cn->v->type == DM_CFG_STRING)
+			printf(" %s=%s", cn->key, cn->v->v.str);
+		else if (cn->v->type == DM_CFG_INT)
+			printf(" %s=%" PRId64, cn->key, cn->v->v.i);
+	}
+
+	printf("\n");
+	fflush(stdout);
+}
+
+static int _watch(void)
+{
+	daemon_handle h = _subscribe();
+	daemon_reply reply;
+
+	printf("subscribed\n");
+	fflush(stdout);
+
+	while (_read_notification(h, &reply)) {
+		_print(reply);
+		daemon_reply_destroy(reply);
+	}
+
+	daemon_reply_destroy(reply);
+	lvmetad_close(h);
+
+	return 0;
+}
+
+static void _send(daemon_handle h, const char *id, const char *pvid)
+{
+	daemon_reply reply;
+	char pvmeta[PVID_LEN + 64];
+
+	if (!strcmp(id, "pv_found")) {
+		snprintf(pvmeta, sizeof(pvmeta),
+			 "{\nid = \"%s\"\nformat = \"lvm2\"\ndevice = 1\n}\n", pvid);
+		reply = daemon_send_simple(h, id, "pvmeta = %b", pvmeta, NULL);
+	} else
+		reply = daemon_send_simple(h, id, "uuid = %s", pvid,
+					   "device = %d", 1, NULL);
+
+	assert(!reply.error && reply.cft);
+	assert(!strcmp(daemon_reply_str(reply, "response", ""), "OK"));
+	daemon_reply_destroy(reply);
+}
+
+static int _overflow(void)
+{
+	daemon_handle sub = _subscribe();
+	daemon_handle h = _open();
+	daemon_reply reply;
+	const char *what;
+	char pvid[PVID_LEN + 1];
+	int i, found = 0;
+
+	memset(pvid, 'x', PVID_LEN);
+	pvid[PVID_LEN] = 0;
+
+	/* Nothing is read from 'sub' meanwhile, so its queue overflows. */
+	for (i = 0; i < FLOOD_REQUESTS; i++)
+		_send(h, "pv_found", pvid);
+
+	while ((what = _read_notification(sub, &reply)) && !strcmp(what, "pv_found")) {
+		found++;
+		daemon_reply_destroy(reply);
+	}
+
+	assert(what && !strcmp(what, "overflow"));
+	assert(found > 0 && found < FLOOD_REQUESTS);
+	daemon_reply_destroy(reply);
+
+	/* Once the loss is reported, notifications flow again. */
+	_send(h, "pv_gone", pvid);
+
+	what = _read_notification(sub, &reply);
+	assert(what && !strcmp(what, "pv_gone"));
+	assert(!strcmp(daemon_reply_str(reply, "pvid", ""), pvid));
+	daemon_reply_destroy(reply);
+
+	lvmetad_close(h);
+	lvmetad_close(sub);
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	assert(argc == 2);
+
+	if (!strcmp(argv[1], "watch"))
+		return _watch();
+
+	assert(!strcmp(argv[1], "overflow"));
+
+	return _overflow();
+}
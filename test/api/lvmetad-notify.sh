@@ -0,0 +1,54 @@
+#!/bin/sh
+# Copyright (C) 2012 Red Hat, Inc. All rights reserved.
+#
+# This file is part of LVM2.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+
+. lib/test
+
+test -e LOCAL_LVMETAD || skip
+
+aux prepare_devs 1
+
+# A subscriber that stops reading is told what it missed.
+aux apitest lvmetad-notify overflow
+
+"$abs_top_builddir/test/api/lvmetad-notify.t" watch > notify &
+WATCH=$!
+
+wait_for_notify() {
+	for i in $(seq 1 50) ; do
+		grep "$1" notify && return 0
+		sleep .1
+	done
+	cat notify
+	return 1
+}
+
+wait_for_notify "^subscribed$"
+
+pvcreate "$dev1"
+pvid=$(get pv_field "$dev1" pv_uuid)
+wait_for_notify "^pv_found pvid=$pvid .*vgid=#orphan$"
+
+vgcreate -c n $vg "$dev1"
+vgid=$(get vg_field $vg vg_uuid)
+wait_for_notify "^vg_update vgid=$vgid name=$vg seqno=1$"
+
+vgchange --addtag foo $vg
+wait_for_notify "^vg_update vgid=$vgid name=$vg seqno=2$"
+
+# Wipe the label behind lvm's back, rescanning tells lvmetad the PV is gone.
+dd if=/dev/zero of="$dev1" bs=4096 count=1
+pvscan --cache "$dev1"
+wait_for_notify "^pv_gone pvid=$pvid "
+wait_for_notify "^vg_remove vgid=$vgid$"
+
+kill $WATCH
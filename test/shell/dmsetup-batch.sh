@@ -0,0 +1,49 @@
+#!/bin/sh
+# Copyright (C) 2012 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+. lib/test
+
+name="${PREFIX}batch"
+
+cat > cmds <<EOF2
+# create, suspend and resume within one process
+create ${name}1 --table "0 8 zero"
+create ${name}2 --table '0 16 zero'
+suspend ${name}1 ${name}2
+resume ${name}1 ${name}2
+EOF2
+
+dmsetup batch cmds | tee out
+test $(grep -c "DM_BATCH_STATUS='ok'" out) -eq 4
+grep "^DM_BATCH_LINE=3 DM_BATCH_COMMAND='suspend'" out
+test -b "$DM_DEV_DIR/mapper/${name}1"
+test -b "$DM_DEV_DIR/mapper/${name}2"
+test $(dmsetup table ${name}2 | cut -d " " -f 2) -eq 16
+
+# stop on the first failure
+cat > cmds <<EOF2
+remove ${name}1
+remove ${name}1
+remove ${name}2
+EOF2
+not dmsetup batch cmds | tee out
+grep "^DM_BATCH_LINE=2 DM_BATCH_COMMAND='remove' DM_BATCH_STATUS='failed'" out
+not grep "DM_BATCH_LINE=3" out
+dmsetup info ${name}2
+
+# table must not be read from stdin holding the commands
+echo "create ${name}3" | not dmsetup batch
+not dmsetup info ${name}3
+
+# carry on with --force
+printf 'remove %s\nremove %s\n' ${name}3 ${name}2 | not dmsetup batch -f | tee out
+grep "^DM_BATCH_LINE=2 DM_BATCH_COMMAND='remove' DM_BATCH_STATUS='ok'" out
+not dmsetup info ${name}2
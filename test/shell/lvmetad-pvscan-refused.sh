@@ -0,0 +1,40 @@
+#!/bin/sh
+# Copyright (C) 2012 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+. lib/test
+
+test -e LOCAL_LVMETAD || skip
+
+aux prepare_devs 2
+
+vgcreate -c n $vg "$dev1" "$dev2"
+dd if="$dev1" of=old1 bs=1M count=1
+dd if="$dev2" of=old2 bs=1M count=1
+vgchange --addtag foo $vg
+
+# Once lvmetad has the metadata on a PV, rescanning it is cheap.
+pvscan --cache "$dev1"
+pvscan --cache -vvvv "$dev1" 2>&1 | grep "Metadata on $dev1 unchanged"
+
+# Older metadata is not taken, nor remembered as what lvmetad has.
+dd if=old1 of="$dev1" bs=1M count=1 conv=notrunc
+pvscan --cache "$dev1"
+pvscan --cache -vvvv "$dev1" 2>&1 | not grep "Metadata on $dev1 unchanged"
+
+# Different metadata with the seqno lvmetad already has is refused ...
+dd if=old2 of="$dev2" bs=1M count=1 conv=notrunc
+vgchange --config 'global { use_lvmetad = 0 }' --addtag bar $vg
+not pvscan --cache "$dev1"
+
+# ... and keeps being refused, rather than taken for unchanged.
+not pvscan --cache "$dev1"
+not pvscan --cache
+vgs -o tags $vg | grep foo
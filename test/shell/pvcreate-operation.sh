@@ -128,3 +128,18 @@ blkid -c /dev/null "$dev1" | grep "swap"
 pvcreate -f "$dev1"
 # blkid cannot make up its mind whether not finding anything it knows is a failure or not
 (blkid -c /dev/null "$dev1" || true) | not grep "swap"
+
+# pvcreate and vgcreate initialise listed devices concurrently, prompting first
+aux lvmconf 'devices/pv_init_parallelism = 2'
+pvremove -f "$dev1"
+mkswap "$dev3"
+echo n | not pvcreate "$dev1" "$dev2" "$dev3" "$dev4" "$dev1" >out
+test $(grep -c "successfully created" out) -eq 4
+pvs "$dev4"
+not pvs "$dev3"
+pvremove -f "$dev1" "$dev2" "$dev4"
+vgcreate -y $vg1 "$dev1" "$dev2" "$dev3"
+vgextend $vg1 "$dev4"
+check pv_field "$dev3" vg_name $vg1
+check pv_field "$dev4" vg_name $vg1
+vgremove -f $vg1
@@ -0,0 +1,68 @@
+#!/bin/sh
+# Copyright (C) 2012 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+. lib/test
+
+test -e LOCAL_LVMETAD || skip
+
+aux prepare_devs 3
+
+# Have the kernel send a change uevent for the device.
+change_event() {
+	local maj=$(($(stat -L --printf=0x%t "$1")))
+	local min=$(($(stat -L --printf=0x%T "$1")))
+	echo change > "/sys/dev/block/$maj:$min/uevent"
+}
+
+# Wait until the watch has logged a line matching $1 at least ${2:-1} times.
+wait_for_watch() {
+	for i in $(seq 1 50) ; do
+		test $(grep -c "$1" watch) -ge ${2:-1} && return 0
+		sleep .1
+	done
+	cat watch
+	return 1
+}
+
+vgcreate -c n $vg "$dev1" "$dev2"
+pvcreate "$dev3"
+dd if="$dev1" of=old1 bs=1M count=1
+dd if="$dev2" of=old2 bs=1M count=1
+vgchange --addtag foo $vg
+
+# Not through the wrapper, so SIGINT reaches the watch itself.
+"$abs_top_builddir/tools/lvm" pvscan --cache --watch -vvvv > watch 2>&1 &
+WATCH=$!
+wait_for_watch "Unlocking .*P_global"
+
+# Write different metadata with the seqno lvmetad already has ...
+dd if=old1 of="$dev1" bs=1M count=1 conv=notrunc
+dd if=old2 of="$dev2" bs=1M count=1 conv=notrunc
+vgchange --config 'global { use_lvmetad = 0 }' --addtag bar $vg
+
+# ... so lvmetad refuses it, and keeps refusing it each time dev2 is retried.
+change_event "$dev2"
+failed="Failed to update lvmetad for device .*, will retry."
+wait_for_watch "$failed" 2
+
+# Failing neither ends the watch nor stops other devices being updated ...
+kill -0 $WATCH
+dd if=/dev/zero of="$dev3" bs=4096 count=1
+change_event "$dev3"
+wait_for_watch "No PV label found on $dev3."
+pvs | not grep "$dev3"
+
+# ... and dev2 stays queued, never taken for unchanged.
+wait_for_watch "$failed" $(($(grep -c "$failed" watch) + 1))
+not grep "Metadata on $dev2 unchanged" watch
+
+kill -INT $WATCH
+wait $WATCH
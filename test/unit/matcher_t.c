@@ -77,9 +77,45 @@ static void test_matching(void) {
 		CU_ASSERT_EQUAL(dm_regex_match(scanner, nonprint[i].str), nonprint[i].expected - 1);
 }
 
+static struct dm_regex *reimport(struct dm_regex *scanner, const char **rx)
+{
+	void *data;
+	size_t size;
+	int nrx = 0;
+	for (; rx[nrx]; ++nrx);
+
+	data = dm_regex_export(scanner, mem, &size);
+	CU_ASSERT_FATAL(data != NULL);
+
+	/* A truncated buffer or a different pattern count is refused. */
+	CU_ASSERT(dm_regex_import(mem, nrx, data, size - sizeof(uint32_t)) == NULL);
+	CU_ASSERT(dm_regex_import(mem, nrx + 1, data, size) == NULL);
+
+	return dm_regex_import(mem, nrx, data, size);
+}
+
+static void test_export(void) {
+	struct dm_regex *scanner;
+	int i;
+
+	scanner = reimport(make_scanner(dev_patterns), dev_patterns);
+	CU_ASSERT_FATAL(scanner != NULL);
+	CU_ASSERT_EQUAL(dm_regex_fingerprint(scanner), 0x7f556c09);
+
+	scanner = reimport(make_scanner(random_patterns), random_patterns);
+	CU_ASSERT_FATAL(scanner != NULL);
+	CU_ASSERT_EQUAL(dm_regex_fingerprint(scanner), 0x9f11076c);
+
+	scanner = reimport(make_scanner(dev_patterns), dev_patterns);
+	CU_ASSERT_FATAL(scanner != NULL);
+	for (i = 0; devices[i].str; ++i)
+		CU_ASSERT_EQUAL(dm_regex_match(scanner, devices[i].str), devices[i].expected - 1);
+}
+
 CU_TestInfo regex_list[] = {
 	{ (char*)"fingerprints", test_fingerprints },
 	{ (char*)"matching", test_matching },
+	{ (char*)"export", test_export },
 	CU_TEST_INFO_NULL
 };
 
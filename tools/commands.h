@@ -672,6 +672,7 @@ xx(pvscan,
    PERMITTED_READ_ONLY,
    "pvscan " "\n"
    "\t[--cache [ DevicePath | --major major --minor minor]...]\n"
+   "\t[--cache --watch [-i|--interval Seconds]]\n"
    "\t[-d|--debug] " "\n"
    "\t{-e|--exported | -n|--novolumegroup} " "\n"
    "\t[-h|-?|--help]" "\n"
@@ -682,8 +683,8 @@ xx(pvscan,
    "\t[-v|--verbose] " "\n"
    "\t[--version]\n",
 
-   cache_ARG, exported_ARG, ignorelockingfailure_ARG, major_ARG, minor_ARG,
-   novolumegroup_ARG, partial_ARG, short_ARG, uuid_ARG)
+   cache_ARG, exported_ARG, ignorelockingfailure_ARG, interval_ARG, major_ARG,
+   minor_ARG, novolumegroup_ARG, partial_ARG, short_ARG, uuid_ARG, watch_ARG)
 
 xx(segtypes,
    "List available segment types",
@@ -190,6 +190,8 @@ static struct dm_tree *_dtree;
 static struct dm_report *_report;
 static report_type_t _report_type;
 static dev_name_t _dev_name_type;
+static const char *_dev_dir;
+static int _batch_stdin;
 
 /*
  * Commands
@@ -262,6 +264,11 @@ static int _parse_file(struct dm_task *dmt, const char *file)
 			err("Couldn't open '%s' for reading", file);
 			return 0;
 		}
+	} else if (_batch_stdin) {
+		/* stdin carries the batch commands themselves */
+		err("Table must be given with --table or in a table_file "
+		    "in batch mode.");
+		return 0;
 	} else
 		fp = stdin;
 
@@ -2970,12 +2977,14 @@ out:
 }
 
 static int _help(CMD_ARGS);
+static int _batch(CMD_ARGS);
 
 /*
  * Dispatch table
  */
 static struct command _commands[] = {
 	{"help", "[-c|-C|--columns]", 0, 0, 0, _help},
+	{"batch", "[-f|--force] [<command_file>]", 0, 1, 0, _batch},
 	{"create", "<dev_name> [-j|--major <major> -m|--minor <minor>]\n"
 	  "\t                  [-U|--uid <uid>] [-G|--gid <gid>] [-M|--mode <octal_mode>]\n"
 	  "\t                  [-u|uuid <uuid>] [{--addnodeonresume|--addnodeoncreate}]\n"
@@ -3704,12 +3713,258 @@ static int _process_switches(int *argc, char ***argv, const char *dev_dir)
 	return 1;
 }
 
+static int _valid_arg_count(const struct command *cmd, int argc)
+{
+	return (argc >= cmd->min_args + 1 &&
+		(cmd->max_args < 0 || argc <= cmd->max_args + 1));
+}
+
+static int _perform_command(const struct command *cmd, int argc, char **argv)
+{
+	int multiple_devices;
+
+	multiple_devices = (cmd->repeatable_cmd && argc != 2 &&
+			    (argc != 1 || (!_switches[UUID_ARG] && !_switches[MAJOR_ARG])));
+	do {
+		if (!cmd->fn(cmd, argc--, argv++, NULL, multiple_devices)) {
+			fprintf(stderr, "Command failed\n");
+			return 0;
+		}
+	} while (cmd->repeatable_cmd && argc > 1);
+
+	return 1;
+}
+
+/*
+ * Split one batch line into arguments in place.
+ * Words are separated by whitespace and may be quoted with ' or ".
+ * A backslash escapes the next character outside single quotes and
+ * a word starting with '#' begins a comment.
+ */
+static int _split_batch_line(char *buffer, int *argc, char **argv)
+{
+	char *s = buffer, *d;
+	char quote;
+
+	*argc = 0;
+	argv[(*argc)++] = (char *) "dmsetup";
+
+	while (1) {
+		while (*s && isspace((int) *s))
+			s++;
+
+		if (!*s || *s == '#')
+			break;
+
+		if (*argc == ARGS_MAX) {
+			err("Too many arguments.");
+			return 0;
+		}
+
+		argv[(*argc)++] = d = s;
+		for (quote = 0; *s && (quote || !isspace((int) *s)); s++) {
+			if (quote && *s == quote)
+				quote = 0;
+			else if (!quote && (*s == '\'' || *s == '"'))
+				quote = *s;
+			else if (*s == '\\' && quote != '\'' && s[1])
+				*d++ = *++s;
+			else
+				*d++ = *s;
+		}
+
+		if (quote) {
+			err("Unterminated quoted string.");
+			return 0;
+		}
+
+		if (*s)
+			s++;
+		*d = '\0';
+	}
+
+	argv[*argc] = NULL;
+
+	return 1;
+}
+
+/*
+ * Run a single command line from a batch with its own switches.
+ */
+static int _batch_command(int argc, char **argv, const char **name)
+{
+	const struct command *cmd;
+	int r = 0;
+
+	dm_free(_table);
+	_table = NULL;
+
+	if (!_process_switches(&argc, &argv, _dev_dir))
+		return 0;
+
+	if (!argc) {
+		err("Missing command.");
+		return 0;
+	}
+
+	if (!(cmd = _find_command(argv[0]))) {
+		err("Unknown command %s.", argv[0]);
+		return 0;
+	}
+
+	*name = cmd->name;
+
+	if (cmd->fn == _batch) {
+		err("Batch commands cannot be nested.");
+		return 0;
+	}
+
+	if (!_valid_arg_count(cmd, argc)) {
+		err("Incorrect number of arguments for %s.", cmd->name);
+		return 0;
+	}
+
+	if (!_switches[COLS_ARG] && !strcmp(cmd->name, "splitname"))
+		_switches[COLS_ARG]++;
+
+	if (!strcmp(cmd->name, "mangle"))
+		dm_set_name_mangling_mode(DM_STRING_MANGLING_NONE);
+
+	if (_switches[COLS_ARG]) {
+		if (!_report_init(cmd))
+			return 0;
+		if (!_report)
+			return !strcmp(cmd->name, "info");  /* info -c -o help */
+	}
+
+	r = _perform_command(cmd, argc, argv);
+
+	if (_report) {
+		dm_report_output(_report);
+		dm_report_free(_report);
+		_report = NULL;
+	}
+
+	if (_dtree) {
+		dm_tree_free(_dtree);
+		_dtree = NULL;
+	}
+
+	return r;
+}
+
+/*
+ * Run each command line read from fp, printing a status line on stdout
+ * after each command.  Stops on the first failure unless force is set.
+ */
+static int _process_batch(FILE *fp, int force)
+{
+	const char *name;
+	char *buffer = NULL;
+	char *args[ARGS_MAX + 1];
+	size_t buffer_size = 0;
+	int udev_sync = dm_udev_get_sync_support();
+	dm_string_mangling_t mangling_mode = dm_get_name_mangling_mode();
+	uint32_t cookie = _udev_cookie;
+	unsigned line = 0, failed = 0;
+	int cmd_argc, cmd_r;
+
+#ifndef HAVE_GETLINE
+	buffer_size = LINE_SIZE;
+	if (!(buffer = dm_malloc(buffer_size))) {
+		err("Failed to malloc line buffer.");
+		return 0;
+	}
+
+	while (fgets(buffer, (int) buffer_size, fp)) {
+#else
+	while (getline(&buffer, &buffer_size, fp) > 0) {
+#endif
+		line++;
+		name = "-";
+
+		if (!_split_batch_line(buffer, &cmd_argc, args))
+			cmd_r = 0;
+		else if (cmd_argc == 1)
+			continue;	/* Blank line or comment */
+		else
+			cmd_r = _batch_command(cmd_argc, args, &name);
+
+		/* Do not let one command's settings leak into the next one */
+		_udev_cookie = cookie;
+		dm_udev_set_sync_support(udev_sync);
+		dm_set_name_mangling_mode(mangling_mode);
+
+		printf("DM_BATCH_LINE=%u DM_BATCH_COMMAND='%s' DM_BATCH_STATUS='%s'\n",
+		       line, name, cmd_r ? "ok" : "failed");
+		fflush(stdout);
+
+		if (!cmd_r) {
+			failed++;
+			if (!force)
+				break;
+		}
+	}
+
+#ifndef HAVE_GETLINE
+	dm_free(buffer);
+#else
+	free(buffer);
+#endif
+
+	return !failed;
+}
+
+/*
+ * Run dmsetup command lines read from command_file or stdin within this
+ * one process, so the control node is opened and the driver version is
+ * checked only once.  Unless a cookie is already supplied, one udev
+ * transaction covers the whole batch and is waited for at the end.
+ */
+static int _batch(CMD_ARGS)
+{
+	const char *file = (argc == 2) ? argv[1] : NULL;
+	uint32_t batch_cookie = 0;
+	FILE *fp;
+	int r = 0;
+
+#ifdef UDEV_SYNC_SUPPORT
+	if (!_udev_cookie) {
+		if (!dm_udev_create_cookie(&batch_cookie))
+			return_0;
+		_udev_cookie = batch_cookie;
+		(void) _set_up_udev_support(_dev_dir);
+	}
+#endif
+
+	if (!file)
+		fp = stdin;
+	else if (!(fp = fopen(file, "r")))
+		err("Couldn't open '%s' for reading", file);
+
+	if (fp) {
+		_batch_stdin = !file;
+		r = _process_batch(fp, _switches[FORCE_ARG]);
+		_batch_stdin = 0;
+
+		if (file && fclose(fp))
+			fprintf(stderr, "%s: fclose failed: %s", file, strerror(errno));
+	}
+
+	if (batch_cookie) {
+		_udev_cookie = 0;
+		if (!dm_udev_wait(batch_cookie))
+			r = 0;
+	}
+
+	return r;
+}
+
 int main(int argc, char **argv)
 {
 	int r = 1;
 	const char *dev_dir;
 	const struct command *cmd;
-	int multiple_devices;
 
 	(void) setlocale(LC_ALL, "");
 
@@ -3722,6 +3977,8 @@ int main(int argc, char **argv)
 	} else
 		dev_dir = DEFAULT_DM_DEV_DIR;
 
+	_dev_dir = dev_dir;
+
 	if (!_process_switches(&argc, &argv, dev_dir)) {
 		fprintf(stderr, "Couldn't process command line.\n");
 		goto out;
@@ -3748,8 +4005,7 @@ int main(int argc, char **argv)
 		goto out;
 	}
 
-	if (argc < cmd->min_args + 1 ||
-	    (cmd->max_args >= 0 && argc > cmd->max_args + 1)) {
+	if (!_valid_arg_count(cmd, argc)) {
 		fprintf(stderr, "Incorrect number of arguments\n");
 		_usage(stderr);
 		goto out;
@@ -3777,14 +4033,8 @@ int main(int argc, char **argv)
 	#endif
 
       doit:
-	multiple_devices = (cmd->repeatable_cmd && argc != 2 &&
-			    (argc != 1 || (!_switches[UUID_ARG] && !_switches[MAJOR_ARG])));
-	do {
-		if (!cmd->fn(cmd, argc--, argv++, NULL, multiple_devices)) {
-			fprintf(stderr, "Command failed\n");
-			goto out;
-		}
-	} while (cmd->repeatable_cmd && argc > 1);
+	if (!_perform_command(cmd, argc, argv))
+		goto out;
 
 	r = 0;
 
@@ -52,6 +52,9 @@ struct lvconvert_params {
 	char **replace_pvs;
 	struct dm_list *replace_pvh;
 
+	int repair_lv_count;	/* Further LVs of vg_name to --repair */
+	const char **repair_lv_names;
+
 	struct logical_volume *lv_to_poll;
 
 	uint64_t poolmetadata_size; /* thin pool */
@@ -141,6 +144,41 @@ static int _lvconvert_name_params(struct lvconvert_params *lp,
 	return 1;
 }
 
+/*
+ * With --repair, further arguments naming LVs in the same VG as the
+ * first one ("vg/lv") are repaired by the same command.  Everything
+ * else remains a PV.
+ */
+static int _lvconvert_repair_lv_params(struct lvconvert_params *lp,
+				       struct cmd_context *cmd,
+				       int *pargc, char **argv)
+{
+	size_t vg_len = strlen(lp->vg_name);
+	int i, pv_count = 0;
+
+	if (!(lp->repair_lv_names = dm_pool_alloc(cmd->mem, (*pargc + 1) *
+						  sizeof(*lp->repair_lv_names)))) {
+		log_error("Failed to allocate LV name list.");
+		return 0;
+	}
+
+	for (i = 0; i < *pargc; i++) {
+		if (!strncmp(argv[i], lp->vg_name, vg_len) &&
+		    argv[i][vg_len] == '/' && argv[i][vg_len + 1] &&
+		    !strchr(argv[i] + vg_len + 1, '/')) {
+			if (!apply_lvname_restrictions(argv[i] + vg_len + 1))
+				return_0;
+			lp->repair_lv_names[lp->repair_lv_count++] =
+				argv[i] + vg_len + 1;
+		} else
+			argv[pv_count++] = argv[i];
+	}
+
+	*pargc = pv_count;
+
+	return 1;
+}
+
 static int _read_params(struct lvconvert_params *lp, struct cmd_context *cmd,
 			int argc, char **argv)
 {
@@ -458,6 +496,9 @@ static int _read_params(struct lvconvert_params *lp, struct cmd_context *cmd,
 	if (!_lvconvert_name_params(lp, cmd, &argc, &argv))
 		return_0;
 
+	if (arg_count(cmd, repair_ARG) && !_lvconvert_repair_lv_params(lp, cmd, &argc, argv))
+		return_0;
+
 	lp->pv_count = argc;
 	lp->pvs = argv;
 
@@ -2183,7 +2224,7 @@ static int lvconvert_merge_single(struct cmd_context *cmd, struct logical_volume
 					  lp->wait_completion);
 
 		/* use LCK_VG_WRITE to match lvconvert()'s READ_FOR_UPDATE */
-		if (!lock_vol(cmd, vg_name, LCK_VG_WRITE)) {
+		if (!lock_vol(cmd, vg_name, LCK_VG_WRITE, NULL)) {
 			log_error("ABORTING: Can't relock VG for %s "
 				  "after polling finished", vg_name);
 			ret = ECMD_FAILED;
@@ -2195,6 +2236,134 @@ static int lvconvert_merge_single(struct cmd_context *cmd, struct logical_volume
 	return ret;
 }
 
+/*
+ * Repair several LVs of one VG.  Failed images of all the RAID LVs are
+ * replaced together, sharing one VG read and the metadata commits.
+ * Other LVs are then repaired one after another as usual.
+ */
+static int _lvconvert_repair_lvs(struct cmd_context *cmd,
+				 struct lvconvert_params *lp)
+{
+	const struct segment_type *segtype = lp->segtype;
+	const char *first_lv_name = lp->lv_name;
+	struct volume_group *vg;
+	struct logical_volume *lv;
+	struct dm_list raid_lvs, *failed_pvs;
+	struct lv_list *lvl;
+	const char *lv_name;
+	const char **other_lvs;
+	int i, other_count = 0, replace, r, ret = ECMD_PROCESSED;
+	int saved_ignore_suspended_devices = ignore_suspended_devices();
+
+	if (!(other_lvs = dm_pool_alloc(cmd->mem, (lp->repair_lv_count + 1) *
+					sizeof(*other_lvs)))) {
+		log_error("Failed to allocate LV name list.");
+		return ECMD_FAILED;
+	}
+
+	init_ignore_suspended_devices(1);
+	cmd->handles_missing_pvs = 1;
+
+	vg = _get_lvconvert_vg(cmd, lp->vg_name, NULL);
+	if (vg_read_error(vg)) {
+		release_vg(vg);
+		stack;
+		ret = ECMD_FAILED;
+		goto out;
+	}
+
+	if (lp->pv_count) {
+		if (!(lp->pvh = create_pv_list(cmd->mem, vg, lp->pv_count,
+					      lp->pvs, 0))) {
+			stack;
+			ret = ECMD_FAILED;
+			goto bad;
+		}
+	} else
+		lp->pvh = &vg->pvs;
+
+	dm_list_init(&raid_lvs);
+
+	for (i = -1; i < lp->repair_lv_count; i++) {
+		lv_name = (i < 0) ? first_lv_name : lp->repair_lv_names[i];
+
+		if (!(lv = find_lv(vg, lv_name))) {
+			log_error("Can't find LV %s in VG %s", lv_name, vg->name);
+			ret = ECMD_FAILED;
+			continue;
+		}
+
+		if (!(lv->status & RAID)) {
+			other_lvs[other_count++] = lv_name;
+			continue;
+		}
+
+		if (!(lvl = dm_pool_alloc(cmd->mem, sizeof(*lvl)))) {
+			log_error("Failed to allocate LV list.");
+			ret = ECMD_FAILED;
+			goto bad;
+		}
+		lvl->lv = lv;
+		dm_list_add(&raid_lvs, &lvl->list);
+	}
+
+	if (dm_list_empty(&raid_lvs))
+		goto bad;
+
+	_lvconvert_raid_repair_ask(cmd, &replace);
+
+	if (!replace) {
+		/* "warn" if policy not set to replace */
+		if (arg_count(cmd, use_policies_ARG))
+			dm_list_iterate_items(lvl, &raid_lvs)
+				log_error("Use 'lvconvert --repair %s/%s' to "
+					  "replace failed device",
+					  vg->name, lvl->lv->name);
+		goto bad;
+	}
+
+	if (!archive(vg) || !(failed_pvs = _failed_pv_list(vg))) {
+		stack;
+		ret = ECMD_FAILED;
+		goto bad;
+	}
+
+	if (!lv_raid_replace_lvs(vg, &raid_lvs, failed_pvs, lp->pvh)) {
+		log_error("Failed to replace faulty devices in %u RAID LVs "
+			  "of %s.", dm_list_size(&raid_lvs), vg->name);
+		ret = ECMD_FAILED;
+		goto bad;
+	}
+
+	dm_list_iterate_items(lvl, &raid_lvs)
+		log_print("Faulty devices in %s/%s successfully replaced.",
+			  vg->name, lvl->lv->name);
+
+	/* If repairing and using policies, remove missing PVs from VG */
+	if (arg_count(cmd, use_policies_ARG)) {
+		if (!(failed_pvs = _failed_pv_list(vg))) {
+			stack;
+			ret = ECMD_FAILED;
+			goto bad;
+		}
+		_remove_missing_empty_pv(vg, failed_pvs);
+	}
+bad:
+	unlock_and_release_vg(cmd, vg, lp->vg_name);
+out:
+	init_ignore_suspended_devices(saved_ignore_suspended_devices);
+
+	for (i = 0; i < other_count; i++) {
+		lp->lv_name = other_lvs[i];
+		lp->segtype = segtype;
+		lp->need_polling = 0;
+		if ((r = lvconvert_single(cmd, lp)) > ret)
+			ret = r;
+	}
+
+	return ret;
+}
+
 int lvconvert(struct cmd_context * cmd, int argc, char **argv)
 {
 	struct lvconvert_params lp;
@@ -2213,5 +2382,8 @@ int lvconvert(struct cmd_context * cmd, int argc, char **argv)
 				       &lvconvert_merge_single);
 	}
 
+	if (lp.repair_lv_count)
+		return _lvconvert_repair_lvs(cmd, &lp);
+
 	return lvconvert_single(cmd, &lp);
 }
@@ -85,6 +85,8 @@ int lvm2_run(void *handle, const char *cmdline)
 		memlock_inc_daemon(cmd);
 	else if (!strcmp(cmdline, "_memlock_dec"))
 		memlock_dec_daemon(cmd);
+	else if (!strcmp(cmdline, "_lvmcache_wipe"))
+		lvmcache_destroy(cmd, 1);
 	else
 		ret = lvm_run_command(cmd, argc, argv);
 
@@ -1096,11 +1096,26 @@ int lvm_run_command(struct cmd_context *cmd, int argc, char **argv)
 		goto out;
 	}
 
+	/*
+	 * Unreferenced devices may stay open while the command runs.
+	 * Long-lived library users (clvmd, liblvm) never get here, so
+	 * they keep closing devices as soon as nobody uses them.
+	 * The same goes for forking processes to initialise new PVs.
+	 */
+	init_dev_open_fd_cache_size(cmd->open_fd_cache_size);
+	init_pv_init_parallelism(cmd->pv_init_parallelism);
+
 	ret = cmd->command->fn(cmd, argc, argv);
 
 	fin_locking();
 
       out:
+	/* Don't hold devices open between commands */
+	init_dev_open_fd_cache_size(0);
+	init_pv_init_parallelism(1);
+	dev_close_all();
+	lvmetad_drop_prefetched_vgs();
+
 	if (test_mode()) {
 		log_verbose("Test mode: Wiping internal cache");
 		lvmcache_destroy(cmd, 1);
@@ -95,6 +95,8 @@ int pvcreate(struct cmd_context *cmd, int argc, char **argv)
 	int ret = ECMD_PROCESSED;
 	struct pvcreate_params pp;
 	struct physical_volume *pv;
+	struct pv_to_create *pvc;
+	struct dm_list pvs_to_create;
 
 	pvcreate_params_set_defaults(&pp);
 
@@ -105,23 +107,49 @@ int pvcreate(struct cmd_context *cmd, int argc, char **argv)
 		return EINVALID_CMD_LINE;
 	}
 
-	for (i = 0; i < argc; i++) {
-		if (!lock_vol(cmd, VG_ORPHANS, LCK_VG_WRITE)) {
-			log_error("Can't get lock for orphan PVs");
-			return ECMD_FAILED;
-		}
+	if (!lock_vol(cmd, VG_ORPHANS, LCK_VG_WRITE, NULL)) {
+		log_error("Can't get lock for orphan PVs");
+		return ECMD_FAILED;
+	}
 
+	for (i = 0; i < argc; i++)
 		dm_unescape_colons_and_at_signs(argv[i], NULL, NULL);
 
-		if (!(pv = pvcreate_single(cmd, argv[i], &pp, 1))) {
+	if (!pvcreate_probe_devices(cmd, &pp, argc, argv)) {
+		ret = ECMD_FAILED;
+		goto out;
+	}
+
+	/*
+	 * Check and set up every device first, so that any prompts come
+	 * before the devices are written, possibly concurrently.
+	 */
+	dm_list_init(&pvs_to_create);
+	for (i = 0; i < argc; i++) {
+		if (!(pv = pvcreate_single(cmd, argv[i], &pp, 0))) {
 			stack;
 			ret = ECMD_FAILED;
+		} else if (!(pvc = dm_pool_alloc(cmd->mem, sizeof(*pvc)))) {
+			log_error("pv_to_create allocation for '%s' failed", argv[i]);
+			ret = ECMD_FAILED;
+			goto out;
+		} else {
+			pvc->pv = pv;
+			pvc->pp = &pp;
+			dm_list_add(&pvs_to_create, &pvc->list);
 		}
 
-		unlock_vg(cmd, VG_ORPHANS);
 		if (sigint_caught())
-			return ret;
+			goto out;
 	}
 
+	if (!pvcreate_write_pvs(cmd, &pvs_to_create)) {
+		stack;
+		ret = ECMD_FAILED;
+	}
+
+out:
+	unlock_vg(cmd, VG_ORPHANS);
+
 	return ret;
 }
@@ -18,6 +18,11 @@
 #include "lvmetad.h"
 #include "lvmcache.h"
 
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <time.h>
+
 int pv_max_name_len = 0;
 int vg_max_name_len = 0;
 
@@ -110,11 +115,10 @@ static int _pvscan_lvmetad_all_devs(struct cmd_context *cmd)
 		return 0;
 	}
 
+	/* One device failing must not keep the rest out of lvmetad. */
 	while ((dev = dev_iter_get(iter))) {
-		if (!pvscan_lvmetad_single(cmd, dev)) {
+		if (!pvscan_lvmetad_single(cmd, dev))
 			r = 0;
-			break;
-		}
 
 		if (sigint_caught())
 			break;
@@ -125,6 +129,232 @@ static int _pvscan_lvmetad_all_devs(struct cmd_context *cmd)
 	return r;
 }
 
+/*
+ * pvscan --cache --watch keeps lvmetad up to date without relying on udev:
+ * it listens to the kernel's block device uevents and rescans only the
+ * devices they name. When events were lost (the socket overflowed), and
+ * every --interval seconds if given, it rescans all devices instead.
+ */
+#define WATCH_PENDING_MAX 256
+#define WATCH_RETRIES 5		/* times to look for a missing device node */
+
+struct watch_dev {
+	dev_t devno;
+	int remove;
+	unsigned retries;
+};
+
+struct watch {
+	int fd;
+	int sweep;		/* rescan all devices */
+	unsigned pending_count;
+	struct watch_dev pending[WATCH_PENDING_MAX];
+};
+
+static void _watch_queue(struct watch *w, dev_t devno, int remove)
+{
+	unsigned i;
+
+	for (i = 0; i < w->pending_count; i++)
+		if (w->pending[i].devno == devno)
+			break;
+
+	if (i == WATCH_PENDING_MAX) {
+		w->sweep = 1;
+		return;
+	}
+
+	if (i == w->pending_count)
+		w->pending_count++;
+
+	w->pending[i].devno = devno;
+	w->pending[i].remove = remove;
+	w->pending[i].retries = 0;
+}
+
+/* Queue the devices named by all uevents waiting on the socket. */
+static void _watch_receive(struct watch *w)
+{
+	char buf[8192];
+	struct sockaddr_nl snl;
+	socklen_t snl_len;
+	const char *p, *action, *subsystem;
+	int major, minor;
+	ssize_t len;
+
+	while (1) {
+		snl_len = sizeof(snl);
+		len = recvfrom(w->fd, buf, sizeof(buf) - 1, MSG_DONTWAIT,
+			       (struct sockaddr *) &snl, &snl_len);
+		if (len < 0) {
+			if (errno == ENOBUFS) {
+				log_verbose("Missed device events, rescanning all devices.");
+				w->sweep = 1;
+				continue;
+			}
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+				log_sys_error("recvfrom", "uevent socket");
+			return;
+		}
+
+		/* Only the kernel is trusted to report devices. */
+		if (!len || snl.nl_pid)
+			continue;
+
+		/* "action@devpath" and then NUL-separated KEY=value pairs */
+		buf[len] = '\0';
+		action = subsystem = NULL;
+		major = minor = -1;
+		for (p = buf + strlen(buf) + 1; p < buf + len; p += strlen(p) + 1) {
+			if (!strncmp(p, "ACTION=", 7))
+				action = p + 7;
+			else if (!strncmp(p, "SUBSYSTEM=", 10))
+				subsystem = p + 10;
+			else if (!strncmp(p, "MAJOR=", 6))
+				major = atoi(p + 6);
+			else if (!strncmp(p, "MINOR=", 6))
+				minor = atoi(p + 6);
+		}
+
+		if (!action || !subsystem || strcmp(subsystem, "block") ||
+		    major < 0 || minor < 0)
+			continue;
+
+		if (!strcmp(action, "add") || !strcmp(action, "change"))
+			_watch_queue(w, MKDEV(major, minor), 0);
+		else if (!strcmp(action, "remove"))
+			_watch_queue(w, MKDEV(major, minor), 1);
+	}
+}
+
+/*
+ * Bring lvmetad up to date with the queued devices. A device that cannot be
+ * updated stays queued for the next pass, as does a failed full rescan, so a
+ * single failure neither stops the watch nor loses the other events.
+ */
+static void _watch_process(struct cmd_context *cmd, struct watch *w)
+{
+	struct watch_dev *wd;
+	struct device *dev;
+	char name[32];
+	unsigned i, kept = 0;
+	int swept = 0, r;
+
+	if (!lock_vol(cmd, VG_GLOBAL, LCK_VG_READ, NULL)) {
+		log_error("Unable to obtain global lock.");
+		return;
+	}
+
+	/* Pick up new device nodes and forget anything read earlier. */
+	persistent_filter_wipe(cmd->filter);
+	lvmcache_destroy(cmd, 1);
+
+	if (w->sweep) {
+		if ((w->sweep = !_pvscan_lvmetad_all_devs(cmd)))
+			log_error("Failed to rescan all devices, will retry.");
+		swept = 1;
+	}
+
+	for (i = 0; i < w->pending_count; i++) {
+		wd = &w->pending[i];
+
+		/* Devices still present are covered by the full rescan. */
+		if (swept && !wd->remove)
+			continue;
+
+		if (dm_snprintf(name, sizeof(name), "%d:%d", (int) MAJOR(wd->devno),
+				(int) MINOR(wd->devno)) < 0)
+			name[0] = '\0';
+
+		dev = wd->remove ? NULL : dev_cache_get_by_devt(wd->devno, NULL);
+
+		if (dev && cmd->filter->passes_filter(cmd->filter, dev))
+			r = pvscan_lvmetad_single(cmd, dev);
+		/* The node of a new device may not have been created yet. */
+		else if (!wd->remove && !dev && ++wd->retries < WATCH_RETRIES) {
+			w->pending[kept++] = *wd;
+			continue;
+		} else
+			/* Removed, or rejected by the filters now (e.g. emptied). */
+			r = lvmetad_pv_gone(wd->devno, name);
+
+		if (!r) {
+			log_error("Failed to update lvmetad for device %s, will retry.", name);
+			w->pending[kept++] = *wd;
+		}
+	}
+
+	w->pending_count = kept;
+
+	unlock_vg(cmd, VG_GLOBAL);
+	/* Don't keep removed devices alive through cached descriptors */
+	dev_close_all();
+}
+
+static int _pvscan_lvmetad_watch(struct cmd_context *cmd)
+{
+	struct sockaddr_nl snl = { .nl_family = AF_NETLINK, .nl_groups = 1 };
+	struct watch w = { .sweep = 1 };
+	int interval = arg_int_value(cmd, interval_ARG, 0);
+	time_t next_sweep = 0, now;
+	struct pollfd pfd;
+	int timeout, r = 0;
+
+	if (interval < 0) {
+		log_error("Interval must be a positive number of seconds.");
+		return 0;
+	}
+
+	if ((w.fd = socket(PF_NETLINK, SOCK_DGRAM, NETLINK_KOBJECT_UEVENT)) < 0) {
+		log_sys_error("socket", "uevent");
+		return 0;
+	}
+
+	if (bind(w.fd, (struct sockaddr *) &snl, sizeof(snl))) {
+		log_sys_error("bind", "uevent socket");
+		goto out;
+	}
+
+	sigint_allow();
+	while (!sigint_caught()) {
+		now = time(NULL);
+		if (interval && now >= next_sweep)
+			w.sweep = 1;
+		if (w.sweep)
+			next_sweep = now + interval;
+
+		if (w.sweep || w.pending_count)
+			_watch_process(cmd, &w);
+
+		if (w.sweep || w.pending_count)
+			timeout = 1000;
+		else if (interval)
+			timeout = (next_sweep > time(NULL)) ? (next_sweep - time(NULL)) * 1000 : 0;
+		else
+			timeout = -1;
+
+		pfd.fd = w.fd;
+		pfd.events = POLLIN;
+		if (poll(&pfd, 1, timeout) < 0) {
+			if (errno == EINTR)
+				continue;
+			log_sys_error("poll", "uevent socket");
+			goto out;
+		}
+
+		if (pfd.revents & POLLIN)
+			_watch_receive(&w);
+	}
+
+	r = 1;
+out:
+	sigint_restore();
+	if (close(w.fd))
+		log_sys_error("close", "uevent socket");
+
+	return r;
+}
+
 static int _pvscan_lvmetad(struct cmd_context *cmd, int argc, char **argv)
 {
 	int ret = ECMD_PROCESSED;
@@ -144,8 +374,21 @@ static int _pvscan_lvmetad(struct cmd_context *cmd, int argc, char **argv)
 		log_error("Both --major and --minor required to identify devices.");
 		return EINVALID_CMD_LINE;
 	}
-	
-	if (!lock_vol(cmd, VG_GLOBAL, LCK_VG_READ)) {
+
+	if (arg_count(cmd, watch_ARG)) {
+		if (argc || devno_args) {
+			log_error("--watch cannot be used with devices.");
+			return EINVALID_CMD_LINE;
+		}
+		return _pvscan_lvmetad_watch(cmd) ? ECMD_PROCESSED : ECMD_FAILED;
+	}
+
+	if (arg_count(cmd, interval_ARG)) {
+		log_error("--interval is only valid with --watch.");
+		return EINVALID_CMD_LINE;
+	}
+
+	if (!lock_vol(cmd, VG_GLOBAL, LCK_VG_READ, NULL)) {
 		log_error("Unable to obtain global lock.");
 		return ECMD_FAILED;
 	}
@@ -242,8 +485,9 @@ int pvscan(struct cmd_context *cmd, int argc, char **argv)
 	if (arg_count(cmd, cache_ARG))
 		return _pvscan_lvmetad(cmd, argc, argv);
 
-	if (arg_count(cmd, major_ARG) + arg_count(cmd, minor_ARG)) {
-		log_error("--major and --minor are only valid with --cache.");
+	if (arg_count(cmd, major_ARG) + arg_count(cmd, minor_ARG) +
+	    arg_count(cmd, watch_ARG) + arg_count(cmd, interval_ARG)) {
+		log_error("--major, --minor, --watch and --interval are only valid with --cache.");
 		return EINVALID_CMD_LINE;
 	}
 
@@ -257,7 +501,7 @@ int pvscan(struct cmd_context *cmd, int argc, char **argv)
 			  arg_count(cmd, exported_ARG) ?
 			  "of exported volume group(s)" : "in no volume group");
 
-	if (!lock_vol(cmd, VG_GLOBAL, LCK_VG_WRITE)) {
+	if (!lock_vol(cmd, VG_GLOBAL, LCK_VG_WRITE, NULL)) {
 		log_error("Unable to obtain global lock.");
 		return ECMD_FAILED;
 	}
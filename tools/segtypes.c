@@ -18,6 +18,11 @@
 int segtypes(struct cmd_context *cmd, int argc __attribute__((unused)),
 	     char **argv __attribute__((unused)))
 {
+	if (!load_segtype_libraries(cmd)) {
+		stack;
+		return ECMD_FAILED;
+	}
+
 	display_segtypes(cmd);
 
 	return ECMD_PROCESSED;
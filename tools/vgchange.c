@@ -186,8 +186,10 @@ static int _vgchange_monitoring(struct cmd_context *cmd, struct volume_group *vg
 
 	if (lvs_in_vg_activated(vg) &&
 	    dmeventd_monitor_mode() != DMEVENTD_MONITOR_IGNORE) {
+		monitor_batch_begin();
 		if (!_monitor_lvs_in_vg(cmd, vg, dmeventd_monitor_mode(), &monitored))
 			r = 0;
+		monitor_batch_end();
 		log_print("%d logical volume(s) in volume group "
 			    "\"%s\" %smonitored",
 			    monitored, vg->name, (dmeventd_monitor_mode()) ? "" : "un");
@@ -239,6 +241,8 @@ static int _vgchange_available(struct cmd_context *cmd, struct volume_group *vg)
 	if (activate)
 		check_current_backup(vg);
 
+	monitor_batch_begin();
+
 	if (activate && (active = lvs_in_vg_activated(vg))) {
 		log_verbose("%d logical volume(s) in volume group \"%s\" "
 			    "already active", active, vg->name);
@@ -255,6 +259,8 @@ static int _vgchange_available(struct cmd_context *cmd, struct volume_group *vg)
 	if (!_activate_lvs_in_vg(cmd, vg, available))
 		r = 0;
 
+	monitor_batch_end();
+
 	/* Print message only if there was not found a missing VG */
 	if (!vg->cmd_missing_vgs)
 		log_print("%d logical volume(s) in volume group \"%s\" now active",
@@ -124,6 +124,8 @@ static int _vgmerge_single(struct cmd_context *cmd, const char *vg_name_to,
 
 		dm_list_move(&vg_to->lvs, lvh);
 	}
+	vg_to->cow_count += vg_from->cow_count;
+	vg_from->cow_count = 0;
 
 	while (!dm_list_empty(&vg_from->fid->metadata_areas_in_use)) {
 		struct dm_list *mdah = vg_from->fid->metadata_areas_in_use.n;
@@ -36,6 +36,11 @@ static int _move_one_lv(struct volume_group *vg_from,
 	dm_list_move(&vg_to->lvs, lvh);
 	lv->vg = vg_to;
 
+	if (lv_is_cow(lv)) {
+		vg_from->cow_count--;
+		vg_to->cow_count++;
+	}
+
 	if (lv_is_active(lv)) {
 		log_error("Logical volume \"%s\" must be inactive", lv->name);
 		return 0;